@@ -2,6 +2,8 @@
 
 #include <string.h>
 
+#include "profiler.h"
+
 void CDReader_Initialise(CDReader_State* const state)
 {
 	state->open = cc_false;
@@ -38,7 +40,7 @@ cc_bool CDReader_IsOpen(const CDReader_State* const state)
 	return state->open;
 }
 
-cc_bool CDReader_SeekToSector(CDReader_State* const state, const CDReader_SectorIndex sector_index)
+static cc_bool AttemptSeekToSector(CDReader_State* const state, const CDReader_SectorIndex sector_index)
 {
 	if (!CDReader_IsOpen(state))
 		return cc_false;
@@ -49,6 +51,17 @@ cc_bool CDReader_SeekToSector(CDReader_State* const state, const CDReader_Sector
 	return ClownCD_SeekSector(&state->clowncd, sector_index);
 }
 
+cc_bool CDReader_SeekToSector(CDReader_State* const state, const CDReader_SectorIndex sector_index)
+{
+	cc_bool success;
+
+	PROFILER_BEGIN(PROFILER_PROBE_CD_SEEK_TO_SECTOR);
+	success = AttemptSeekToSector(state, sector_index);
+	PROFILER_END(PROFILER_PROBE_CD_SEEK_TO_SECTOR);
+
+	return success;
+}
+
 static size_t AttemptReadSector(CDReader_State* const state, cc_u16l* const buffer)
 {
 	cc_u16f i;
@@ -78,11 +91,16 @@ cc_bool CDReader_ReadSector(CDReader_State* const state, cc_u16l* const buffer)
 {
 	size_t words_read = 0;
 
+	PROFILER_BEGIN(PROFILER_PROBE_CD_READ_SECTOR);
+
 	if (CDReader_IsOpen(state))
 		words_read = AttemptReadSector(state, buffer);
 
 	memset(buffer + words_read, 0, (CDREADER_SECTOR_SIZE / 2 - words_read) * sizeof(cc_u16l));
 
+	PROFILER_END(PROFILER_PROBE_CD_READ_SECTOR);
+	PROFILER_COUNT(PROFILER_COUNTER_CD_SECTORS_READ, words_read != 0);
+
 	return words_read != 0;
 }
 
@@ -113,7 +131,7 @@ cc_bool CDReader_SeekToFrame(CDReader_State* const state, const CDReader_FrameIn
 	return cc_true;
 }
 
-cc_u32f CDReader_ReadAudio(CDReader_State* const state, cc_s16l* const sample_buffer, const cc_u32f total_frames)
+static cc_u32f AttemptReadAudio(CDReader_State* const state, cc_s16l* const sample_buffer, const cc_u32f total_frames)
 {
 	cc_u32f frames_read = 0;
 
@@ -153,6 +171,18 @@ cc_u32f CDReader_ReadAudio(CDReader_State* const state, cc_s16l* const sample_bu
 	return frames_read;
 }
 
+cc_u32f CDReader_ReadAudio(CDReader_State* const state, cc_s16l* const sample_buffer, const cc_u32f total_frames)
+{
+	cc_u32f frames_read;
+
+	PROFILER_BEGIN(PROFILER_PROBE_CD_READ_AUDIO);
+	frames_read = AttemptReadAudio(state, sample_buffer, total_frames);
+	PROFILER_END(PROFILER_PROBE_CD_READ_AUDIO);
+	PROFILER_COUNT(PROFILER_COUNTER_CD_AUDIO_FRAMES_READ, frames_read);
+
+	return frames_read;
+}
+
 void CDReader_SaveState(const CDReader_State* const state, CDReader_StateBackup* const backup)
 {
 	backup->track_index = state->clowncd.track.current_track;
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "profiler.h"
+
 #define CheatManager_IsROMCheat(CHEAT) (((CHEAT)->address & 0xFFFFFF) < rom_length * 2)
 #define CheatManager_IsRAMCheat(CHEAT) (((CHEAT)->address & 0xFFFFFF) >= 0xE00000)
 
@@ -190,13 +192,27 @@ static cc_bool CheatManager_DecodeActionReplay(CheatManager_DecodedCheat* const
 	return cc_false;
 }
 
+static void CheatManager_UndoROMPatch(CheatManager* const manager, cc_u16l* const rom, const size_t rom_length, const unsigned int index)
+{
+	if (manager->cheats[index].enabled && CheatManager_IsROMCheat(&manager->cheats[index].code))
+		rom[(manager->cheats[index].code.address & 0xFFFFFF) / 2] = manager->cheats[index].old_rom_value;
+}
+
+static void CheatManager_ApplyROMPatch(CheatManager* const manager, cc_u16l* const rom, const size_t rom_length, const unsigned int index)
+{
+	if (manager->cheats[index].enabled && CheatManager_IsROMCheat(&manager->cheats[index].code))
+	{
+		manager->cheats[index].old_rom_value = rom[(manager->cheats[index].code.address & 0xFFFFFF) / 2];
+		rom[(manager->cheats[index].code.address & 0xFFFFFF) / 2] = manager->cheats[index].code.value;
+	}
+}
+
 void CheatManager_UndoROMPatches(CheatManager* const manager, cc_u16l* const rom, const size_t rom_length)
 {
 	unsigned int i;
 
 	for (i = manager->total_cheats; i-- != 0; )
-		if (manager->cheats[i].enabled && CheatManager_IsROMCheat(&manager->cheats[i].code))
-			rom[manager->cheats[i].code.address / 2] = manager->cheats[i].old_rom_value;
+		CheatManager_UndoROMPatch(manager, rom, rom_length, i);
 }
 
 void CheatManager_ApplyROMPatches(CheatManager* const manager, cc_u16l* const rom, const size_t rom_length)
@@ -204,22 +220,30 @@ void CheatManager_ApplyROMPatches(CheatManager* const manager, cc_u16l* const ro
 	unsigned int i;
 
 	for (i = 0; i < manager->total_cheats; ++i)
-	{
-		if (manager->cheats[i].enabled && CheatManager_IsROMCheat(&manager->cheats[i].code))
-		{
-			manager->cheats[i].old_rom_value = rom[manager->cheats[i].code.address / 2];
-			rom[manager->cheats[i].code.address / 2] = manager->cheats[i].code.value;
-		}
-	}
+		CheatManager_ApplyROMPatch(manager, rom, rom_length, i);
 }
 
 void CheatManager_ApplyRAMPatches(CheatManager* const manager, ClownMDEmu* const clownmdemu)
 {
 	unsigned int i;
 
+	PROFILER_BEGIN(PROFILER_PROBE_CHEAT_APPLY_RAM_PATCHES);
+
 	for (i = 0; i < manager->total_cheats; ++i)
+	{
 		if (manager->cheats[i].enabled && CheatManager_IsRAMCheat(&manager->cheats[i].code))
-			clownmdemu->state.m68k.ram[(manager->cheats[i].code.address / 2) % CC_COUNT_OF(clownmdemu->state.m68k.ram)] = manager->cheats[i].code.value;
+		{
+			CheatManager_ApplyRAMPatch(clownmdemu, &manager->cheats[i].code);
+			PROFILER_COUNT(PROFILER_COUNTER_RAM_PATCHES_APPLIED, 1);
+		}
+	}
+
+	PROFILER_END(PROFILER_PROBE_CHEAT_APPLY_RAM_PATCHES);
+}
+
+void CheatManager_ApplyRAMPatch(ClownMDEmu* const clownmdemu, const CheatManager_DecodedCheat* const decoded_cheat)
+{
+	clownmdemu->state.m68k.ram[(decoded_cheat->address / 2) % CC_COUNT_OF(clownmdemu->state.m68k.ram)] = decoded_cheat->value;
 }
 
 cc_bool CheatManager_DecodeCheat(CheatManager_DecodedCheat *const decoded_cheat, const char *const code)
@@ -279,3 +303,125 @@ cc_bool CheatManager_AddCheat(CheatManager* const manager, cc_u16l *const rom, c
 
 	return CheatManager_AddDecodedCheat(manager, rom, rom_length, index, enabled, &decoded_cheat);
 }
+
+void CheatManager_SaveSnapshot(const CheatManager* const manager, CheatManager_Snapshot* const snapshot)
+{
+	unsigned int i;
+
+	for (i = 0; i < manager->total_cheats; ++i)
+	{
+		snapshot->cheats[i].code = manager->cheats[i].code;
+		snapshot->cheats[i].enabled = manager->cheats[i].enabled;
+	}
+
+	snapshot->total_cheats = manager->total_cheats;
+}
+
+static cc_bool CheatManager_SnapshotMatches(const CheatManager* const manager, const CheatManager_Snapshot* const snapshot, const unsigned int index)
+{
+	const cc_bool in_manager = index < manager->total_cheats;
+	const cc_bool in_snapshot = index < snapshot->total_cheats;
+
+	if (in_manager && in_snapshot)
+		return manager->cheats[index].enabled == snapshot->cheats[index].enabled
+			&& manager->cheats[index].code.address == snapshot->cheats[index].code.address
+			&& manager->cheats[index].code.value == snapshot->cheats[index].code.value;
+
+	/* A missing cheat is equivalent to a disabled one. */
+	if (in_manager)
+		return !manager->cheats[index].enabled;
+	else if (in_snapshot)
+		return !snapshot->cheats[index].enabled;
+
+	return cc_true;
+}
+
+void CheatManager_LoadSnapshot(CheatManager* const manager, cc_u16l* const rom, const size_t rom_length, const CheatManager_Snapshot* const snapshot)
+{
+	const unsigned int total_cheats = CC_MAX(manager->total_cheats, snapshot->total_cheats);
+
+	unsigned int first_difference, i;
+
+	/* Usually the cheats have not changed since the snapshot was made, in which case there is nothing to do. */
+	for (first_difference = 0; first_difference < total_cheats; ++first_difference)
+		if (!CheatManager_SnapshotMatches(manager, snapshot, first_difference))
+			break;
+
+	if (first_difference == total_cheats)
+		return;
+
+	/* Since patches to the same address are stacked, undoing them in reverse down to the first
+	   difference leaves the ROM as it was after the earlier, unchanged cheats were applied. */
+	for (i = manager->total_cheats; i-- > first_difference; )
+		CheatManager_UndoROMPatch(manager, rom, rom_length, i);
+
+	for (i = first_difference; i < total_cheats; ++i)
+	{
+		if (i < snapshot->total_cheats)
+		{
+			manager->cheats[i].code = snapshot->cheats[i].code;
+			manager->cheats[i].enabled = snapshot->cheats[i].enabled;
+		}
+		else
+		{
+			memset(&manager->cheats[i], 0, sizeof(manager->cheats[i]));
+		}
+	}
+
+	manager->total_cheats = snapshot->total_cheats;
+
+	for (i = first_difference; i < manager->total_cheats; ++i)
+		CheatManager_ApplyROMPatch(manager, rom, rom_length, i);
+}
+
+size_t CheatManager_SerialiseSnapshot(const CheatManager_Snapshot* const snapshot, unsigned char* const buffer)
+{
+	unsigned char *pointer = buffer;
+	unsigned int i;
+
+	/* Everything is big-endian, so that the format does not depend on the host. */
+	*pointer++ = (snapshot->total_cheats >> 8) & 0xFF;
+	*pointer++ = (snapshot->total_cheats >> 0) & 0xFF;
+
+	for (i = 0; i < snapshot->total_cheats; ++i)
+	{
+		*pointer++ = (snapshot->cheats[i].code.address >> 24) & 0xFF;
+		*pointer++ = (snapshot->cheats[i].code.address >> 16) & 0xFF;
+		*pointer++ = (snapshot->cheats[i].code.address >> 8) & 0xFF;
+		*pointer++ = (snapshot->cheats[i].code.address >> 0) & 0xFF;
+		*pointer++ = (snapshot->cheats[i].code.value >> 8) & 0xFF;
+		*pointer++ = (snapshot->cheats[i].code.value >> 0) & 0xFF;
+		*pointer++ = snapshot->cheats[i].enabled ? 1 : 0;
+	}
+
+	return pointer - buffer;
+}
+
+cc_bool CheatManager_DeserialiseSnapshot(CheatManager_Snapshot* const snapshot, const unsigned char* const buffer, const size_t buffer_size)
+{
+	const unsigned char *pointer = buffer;
+	unsigned int i;
+
+	if (buffer_size < 2)
+		return cc_false;
+
+	snapshot->total_cheats = (unsigned int)pointer[0] << 8 | pointer[1];
+	pointer += 2;
+
+	if (snapshot->total_cheats > CC_COUNT_OF(snapshot->cheats) || buffer_size < 2 + (size_t)snapshot->total_cheats * 7)
+		return cc_false;
+
+	for (i = 0; i < snapshot->total_cheats; ++i)
+	{
+		snapshot->cheats[i].code.address = (unsigned long)pointer[0] << 24 | (unsigned long)pointer[1] << 16 | (unsigned long)pointer[2] << 8 | pointer[3];
+		snapshot->cheats[i].code.value = (unsigned short)(pointer[4] << 8 | pointer[5]);
+		snapshot->cheats[i].enabled = pointer[6] != 0;
+		pointer += 7;
+
+		/* Reject anything that the decoders could not have produced. */
+		if (snapshot->cheats[i].code.address > 0xFFFFFF || snapshot->cheats[i].code.address % 2 != 0)
+			return cc_false;
+	}
+
+	return cc_true;
+}
@@ -4,6 +4,11 @@
 #include "core/libraries/clowncommon/clowncommon.h"
 #include "core/source/clownmdemu.h"
 
+#define CHEATMANAGER_MAXIMUM_CHEATS 0x100
+
+/* The total count, followed by the address, value, and enabled flag of each cheat. */
+#define CHEATMANAGER_SNAPSHOT_MAXIMUM_SERIALISED_SIZE (2 + CHEATMANAGER_MAXIMUM_CHEATS * (4 + 2 + 1))
+
 typedef struct CheatManager_DecodedCheat
 {
 	unsigned long address;
@@ -17,11 +22,24 @@ typedef struct CheatManager
 		CheatManager_DecodedCheat code;
 		cc_u16l old_rom_value;
 		cc_bool enabled;
-	} cheats[0x100];
+	} cheats[CHEATMANAGER_MAXIMUM_CHEATS];
 
 	unsigned int total_cheats;
 } CheatManager;
 
+/* Unlike the manager itself, this does not depend on the contents of the ROM,
+   so it can be stored alongside save states and restored cheaply. */
+typedef struct CheatManager_Snapshot
+{
+	struct
+	{
+		CheatManager_DecodedCheat code;
+		cc_bool enabled;
+	} cheats[CHEATMANAGER_MAXIMUM_CHEATS];
+
+	unsigned int total_cheats;
+} CheatManager_Snapshot;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,6 +47,7 @@ extern "C" {
 void CheatManager_UndoROMPatches(CheatManager *manager, cc_u16l *rom, size_t rom_length);
 void CheatManager_ApplyROMPatches(CheatManager *manager, cc_u16l *rom, size_t rom_length);
 void CheatManager_ApplyRAMPatches(CheatManager *manager, ClownMDEmu *clownmdemu);
+void CheatManager_ApplyRAMPatch(ClownMDEmu *clownmdemu, const CheatManager_DecodedCheat *decoded_cheat);
 
 cc_bool CheatManager_DecodeCheat(CheatManager_DecodedCheat *decoded_cheat, const char *code);
 
@@ -36,6 +55,11 @@ void CheatManager_ResetCheats(CheatManager *manager, cc_u16l *rom, size_t rom_le
 cc_bool CheatManager_AddDecodedCheat(CheatManager *manager, cc_u16l *rom, size_t rom_length, unsigned int index, cc_bool enabled, const CheatManager_DecodedCheat *decoded_cheat);
 cc_bool CheatManager_AddCheat(CheatManager *manager, cc_u16l *rom, size_t rom_length, unsigned int index, cc_bool enabled, const char *code);
 
+void CheatManager_SaveSnapshot(const CheatManager *manager, CheatManager_Snapshot *snapshot);
+void CheatManager_LoadSnapshot(CheatManager *manager, cc_u16l *rom, size_t rom_length, const CheatManager_Snapshot *snapshot);
+size_t CheatManager_SerialiseSnapshot(const CheatManager_Snapshot *snapshot, unsigned char *buffer);
+cc_bool CheatManager_DeserialiseSnapshot(CheatManager_Snapshot *snapshot, const unsigned char *buffer, size_t buffer_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -65,6 +89,11 @@ public:
 		CheatManager_ApplyRAMPatches(this, clownmdemu);
 	}
 
+	static void ApplyRAMPatch(ClownMDEmu* const clownmdemu, const CheatManager_DecodedCheat* const decoded_cheat)
+	{
+		CheatManager_ApplyRAMPatch(clownmdemu, decoded_cheat);
+	}
+
 	static bool DecodeCheat(CheatManager_DecodedCheat* const decoded_cheat, const char* const code)
 	{
 		return CheatManager_DecodeCheat(decoded_cheat, code);
@@ -84,6 +113,26 @@ public:
 	{
 		return CheatManager_AddCheat(this, rom, rom_length, index, enabled, code);
 	}
+
+	void SaveSnapshot(CheatManager_Snapshot* const snapshot) const
+	{
+		CheatManager_SaveSnapshot(this, snapshot);
+	}
+
+	void LoadSnapshot(cc_u16l* const rom, const std::size_t rom_length, const CheatManager_Snapshot* const snapshot)
+	{
+		CheatManager_LoadSnapshot(this, rom, rom_length, snapshot);
+	}
+
+	static std::size_t SerialiseSnapshot(const CheatManager_Snapshot* const snapshot, unsigned char* const buffer)
+	{
+		return CheatManager_SerialiseSnapshot(snapshot, buffer);
+	}
+
+	static bool DeserialiseSnapshot(CheatManager_Snapshot* const snapshot, const unsigned char* const buffer, const std::size_t buffer_size)
+	{
+		return CheatManager_DeserialiseSnapshot(snapshot, buffer, buffer_size);
+	}
 };
 
 #endif
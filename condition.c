@@ -0,0 +1,495 @@
+#include "condition.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONDITIONMANAGER_RAM_LENGTH CC_COUNT_OF(((const ClownMDEmu*)NULL)->state.m68k.ram)
+#define CONDITIONMANAGER_MAXIMUM_NESTING 0x10
+
+#define ConditionManager_IsRAMAddress(ADDRESS) (((ADDRESS) & 0xFFFFFF) >= 0xE00000)
+
+typedef struct ConditionManager_Parser
+{
+	ConditionManager *manager;
+	const char *cursor;
+	unsigned int stack_depth;
+	unsigned int nesting;
+} ConditionManager_Parser;
+
+/* Compilation */
+
+static void ConditionManager_SkipWhitespace(ConditionManager_Parser* const parser)
+{
+	while (*parser->cursor == ' ' || *parser->cursor == '\t')
+		++parser->cursor;
+}
+
+static cc_bool ConditionManager_Accept(ConditionManager_Parser* const parser, const char* const token)
+{
+	const size_t length = strlen(token);
+
+	ConditionManager_SkipWhitespace(parser);
+
+	if (strncmp(parser->cursor, token, length) != 0)
+		return cc_false;
+
+	parser->cursor += length;
+	return cc_true;
+}
+
+static cc_bool ConditionManager_IsDigit(const char character, const int base)
+{
+	if (character >= '0' && character <= '9')
+		return cc_true;
+
+	if (base == 16)
+		return (character >= 'A' && character <= 'F') || (character >= 'a' && character <= 'f');
+
+	return cc_false;
+}
+
+static cc_bool ConditionManager_ParseInteger(ConditionManager_Parser* const parser, const int base, unsigned long* const value)
+{
+	char *end;
+
+	/* 'strtoul' is too lenient: it allows signs and whitespace. */
+	if (!ConditionManager_IsDigit(*parser->cursor, base))
+		return cc_false;
+
+	*value = strtoul(parser->cursor, &end, base);
+	parser->cursor = end;
+
+	return *value <= 0xFFFFFFFF;
+}
+
+static cc_bool ConditionManager_ParseConstant(ConditionManager_Parser* const parser, unsigned long* const value)
+{
+	ConditionManager_SkipWhitespace(parser);
+
+	if (parser->cursor[0] == '0' && (parser->cursor[1] == 'x' || parser->cursor[1] == 'X'))
+	{
+		parser->cursor += 2;
+		return ConditionManager_ParseInteger(parser, 16, value);
+	}
+
+	return ConditionManager_ParseInteger(parser, 10, value);
+}
+
+static cc_bool ConditionManager_AddRead(ConditionManager* const manager, const ConditionManager_ReadSize size, const unsigned long address, cc_u32l* const index)
+{
+	const cc_u16f offset = address % (CONDITIONMANAGER_RAM_LENGTH * 2);
+
+	unsigned int i;
+
+	/* Share the read with any other condition that uses it. */
+	for (i = 0; i < manager->total_reads; ++i)
+	{
+		if (manager->reads[i].offset == offset && manager->reads[i].size == size)
+		{
+			*index = i;
+			return cc_true;
+		}
+	}
+
+	if (manager->total_reads == CC_COUNT_OF(manager->reads))
+		return cc_false;
+
+	manager->reads[manager->total_reads].offset = offset;
+	manager->reads[manager->total_reads].size = size;
+	*index = manager->total_reads++;
+
+	return cc_true;
+}
+
+static cc_bool ConditionManager_ParseOperand(ConditionManager_Parser* const parser, cc_u8l* const type, cc_u32l* const operand)
+{
+	cc_bool delta = cc_false;
+	ConditionManager_ReadSize size;
+	unsigned long value;
+
+	ConditionManager_SkipWhitespace(parser);
+
+	if (parser->cursor[0] == 'd' && parser->cursor[1] != '\0' && parser->cursor[2] == '[')
+	{
+		delta = cc_true;
+		++parser->cursor;
+	}
+
+	switch (parser->cursor[0])
+	{
+		case 'b':
+			size = CONDITIONMANAGER_READ_BYTE;
+			break;
+
+		case 'w':
+			size = CONDITIONMANAGER_READ_WORD;
+			break;
+
+		case 'l':
+			size = CONDITIONMANAGER_READ_LONGWORD;
+			break;
+
+		default:
+			/* Not a memory read, so it must be a constant. */
+			if (delta || !ConditionManager_ParseConstant(parser, &value))
+				return cc_false;
+
+			*type = CONDITIONMANAGER_OPERAND_CONSTANT;
+			*operand = value;
+			return cc_true;
+	}
+
+	++parser->cursor;
+
+	if (*parser->cursor++ != '[')
+		return cc_false;
+
+	if (!ConditionManager_ParseInteger(parser, 16, &value))
+		return cc_false;
+
+	if (*parser->cursor++ != ']')
+		return cc_false;
+
+	/* Only RAM can be read, and the 68000 cannot perform unaligned word accesses. */
+	if (!ConditionManager_IsRAMAddress(value) || (size != CONDITIONMANAGER_READ_BYTE && value % 2 != 0))
+		return cc_false;
+
+	*type = delta ? CONDITIONMANAGER_OPERAND_PREVIOUS : CONDITIONMANAGER_OPERAND_CURRENT;
+	return ConditionManager_AddRead(parser->manager, size, value, operand);
+}
+
+static ConditionManager_Instruction* ConditionManager_Emit(ConditionManager_Parser* const parser, const ConditionManager_Opcode opcode)
+{
+	ConditionManager* const manager = parser->manager;
+
+	ConditionManager_Instruction *instruction;
+
+	if (manager->total_instructions == CC_COUNT_OF(manager->instructions))
+		return NULL;
+
+	/* Comparisons push a result, and groups combine two results into one. */
+	if (opcode == CONDITIONMANAGER_OPCODE_AND || opcode == CONDITIONMANAGER_OPCODE_OR)
+		--parser->stack_depth;
+	else if (++parser->stack_depth > CONDITIONMANAGER_MAXIMUM_STACK_DEPTH)
+		return NULL;
+
+	instruction = &manager->instructions[manager->total_instructions++];
+	instruction->opcode = opcode;
+	instruction->operand_types[0] = instruction->operand_types[1] = CONDITIONMANAGER_OPERAND_CONSTANT;
+	instruction->operands[0] = instruction->operands[1] = 0;
+	instruction->hit_target = 0;
+	instruction->hits = 0;
+
+	return instruction;
+}
+
+static cc_bool ConditionManager_ParseComparison(ConditionManager_Parser* const parser)
+{
+	static const struct
+	{
+		const char *token;
+		ConditionManager_Opcode opcode;
+	} comparisons[] = {
+		/* The longer tokens must come first. */
+		{"==", CONDITIONMANAGER_OPCODE_EQUAL},
+		{"!=", CONDITIONMANAGER_OPCODE_NOT_EQUAL},
+		{"<=", CONDITIONMANAGER_OPCODE_LESS_OR_EQUAL},
+		{">=", CONDITIONMANAGER_OPCODE_GREATER_OR_EQUAL},
+		{"<",  CONDITIONMANAGER_OPCODE_LESS},
+		{">",  CONDITIONMANAGER_OPCODE_GREATER}
+	};
+
+	cc_u8l operand_types[2];
+	cc_u32l operands[2];
+	unsigned long hit_target = 0;
+	unsigned int i;
+	ConditionManager_Instruction *instruction;
+
+	if (!ConditionManager_ParseOperand(parser, &operand_types[0], &operands[0]))
+		return cc_false;
+
+	for (i = 0; i < CC_COUNT_OF(comparisons); ++i)
+		if (ConditionManager_Accept(parser, comparisons[i].token))
+			break;
+
+	if (i == CC_COUNT_OF(comparisons))
+		return cc_false;
+
+	if (!ConditionManager_ParseOperand(parser, &operand_types[1], &operands[1]))
+		return cc_false;
+
+	if (ConditionManager_Accept(parser, "{"))
+		if (!ConditionManager_ParseConstant(parser, &hit_target) || hit_target == 0 || !ConditionManager_Accept(parser, "}"))
+			return cc_false;
+
+	instruction = ConditionManager_Emit(parser, comparisons[i].opcode);
+
+	if (instruction == NULL)
+		return cc_false;
+
+	instruction->operand_types[0] = operand_types[0];
+	instruction->operand_types[1] = operand_types[1];
+	instruction->operands[0] = operands[0];
+	instruction->operands[1] = operands[1];
+	instruction->hit_target = hit_target;
+
+	return cc_true;
+}
+
+static cc_bool ConditionManager_ParseOr(ConditionManager_Parser *parser);
+
+static cc_bool ConditionManager_ParsePrimary(ConditionManager_Parser* const parser)
+{
+	cc_bool success;
+
+	if (!ConditionManager_Accept(parser, "("))
+		return ConditionManager_ParseComparison(parser);
+
+	if (++parser->nesting > CONDITIONMANAGER_MAXIMUM_NESTING)
+		return cc_false;
+
+	success = ConditionManager_ParseOr(parser) && ConditionManager_Accept(parser, ")");
+
+	--parser->nesting;
+
+	return success;
+}
+
+static cc_bool ConditionManager_ParseAnd(ConditionManager_Parser* const parser)
+{
+	if (!ConditionManager_ParsePrimary(parser))
+		return cc_false;
+
+	while (ConditionManager_Accept(parser, "&&"))
+		if (!ConditionManager_ParsePrimary(parser) || ConditionManager_Emit(parser, CONDITIONMANAGER_OPCODE_AND) == NULL)
+			return cc_false;
+
+	return cc_true;
+}
+
+static cc_bool ConditionManager_ParseOr(ConditionManager_Parser* const parser)
+{
+	if (!ConditionManager_ParseAnd(parser))
+		return cc_false;
+
+	while (ConditionManager_Accept(parser, "||"))
+		if (!ConditionManager_ParseAnd(parser) || ConditionManager_Emit(parser, CONDITIONMANAGER_OPCODE_OR) == NULL)
+			return cc_false;
+
+	return cc_true;
+}
+
+/* Evaluation */
+
+static cc_u32f ConditionManager_FetchRead(const cc_u16l* const ram, const ConditionManager_Read* const read)
+{
+	const cc_u16f word_index = read->offset / 2;
+
+	switch ((ConditionManager_ReadSize)read->size)
+	{
+		case CONDITIONMANAGER_READ_BYTE:
+			/* The 68000 is big-endian. */
+			return read->offset % 2 != 0 ? ram[word_index] & 0xFF : ram[word_index] >> 8;
+
+		case CONDITIONMANAGER_READ_WORD:
+			return ram[word_index];
+
+		case CONDITIONMANAGER_READ_LONGWORD:
+			return (cc_u32f)ram[word_index] << 16 | ram[(word_index + 1) % CONDITIONMANAGER_RAM_LENGTH];
+	}
+
+	return 0;
+}
+
+static cc_u32f ConditionManager_GetOperand(const ConditionManager* const manager, const ConditionManager_Instruction* const instruction, const cc_u8f operand)
+{
+	switch ((ConditionManager_OperandType)instruction->operand_types[operand])
+	{
+		case CONDITIONMANAGER_OPERAND_CONSTANT:
+			return instruction->operands[operand];
+
+		case CONDITIONMANAGER_OPERAND_CURRENT:
+			return manager->current_values[instruction->operands[operand]];
+
+		case CONDITIONMANAGER_OPERAND_PREVIOUS:
+			return manager->previous_values[instruction->operands[operand]];
+	}
+
+	return 0;
+}
+
+static cc_bool ConditionManager_Execute(ConditionManager* const manager, const unsigned int first_instruction, const unsigned int total_instructions)
+{
+	cc_bool stack[CONDITIONMANAGER_MAXIMUM_STACK_DEPTH];
+	unsigned int stack_depth = 0;
+	unsigned int i;
+
+	for (i = first_instruction; i < first_instruction + total_instructions; ++i)
+	{
+		ConditionManager_Instruction* const instruction = &manager->instructions[i];
+
+		cc_u32f left, right;
+		cc_bool result;
+
+		switch ((ConditionManager_Opcode)instruction->opcode)
+		{
+			case CONDITIONMANAGER_OPCODE_AND:
+				--stack_depth;
+				stack[stack_depth - 1] = stack[stack_depth - 1] && stack[stack_depth];
+				continue;
+
+			case CONDITIONMANAGER_OPCODE_OR:
+				--stack_depth;
+				stack[stack_depth - 1] = stack[stack_depth - 1] || stack[stack_depth];
+				continue;
+
+			default:
+				break;
+		}
+
+		left = ConditionManager_GetOperand(manager, instruction, 0);
+		right = ConditionManager_GetOperand(manager, instruction, 1);
+
+		switch ((ConditionManager_Opcode)instruction->opcode)
+		{
+			case CONDITIONMANAGER_OPCODE_EQUAL:
+				result = left == right;
+				break;
+
+			case CONDITIONMANAGER_OPCODE_NOT_EQUAL:
+				result = left != right;
+				break;
+
+			case CONDITIONMANAGER_OPCODE_LESS:
+				result = left < right;
+				break;
+
+			case CONDITIONMANAGER_OPCODE_LESS_OR_EQUAL:
+				result = left <= right;
+				break;
+
+			case CONDITIONMANAGER_OPCODE_GREATER:
+				result = left > right;
+				break;
+
+			case CONDITIONMANAGER_OPCODE_GREATER_OR_EQUAL:
+				result = left >= right;
+				break;
+
+			default:
+				result = cc_false;
+				break;
+		}
+
+		if (instruction->hit_target != 0)
+		{
+			if (result && instruction->hits < instruction->hit_target)
+				++instruction->hits;
+
+			result = instruction->hits >= instruction->hit_target;
+		}
+
+		stack[stack_depth++] = result;
+	}
+
+	return stack[0];
+}
+
+/* API */
+
+void ConditionManager_Initialise(ConditionManager* const manager)
+{
+	ConditionManager_ResetConditions(manager);
+}
+
+void ConditionManager_ResetConditions(ConditionManager* const manager)
+{
+	manager->total_reads = 0;
+	manager->total_primed_reads = 0;
+	manager->total_instructions = 0;
+	manager->total_conditions = 0;
+}
+
+cc_bool ConditionManager_AddCondition(ConditionManager* const manager, const char* const expression, unsigned int* const index)
+{
+	const unsigned int total_reads = manager->total_reads;
+	const unsigned int total_instructions = manager->total_instructions;
+
+	ConditionManager_Parser parser;
+	cc_bool success;
+
+	if (manager->total_conditions == CC_COUNT_OF(manager->conditions))
+		return cc_false;
+
+	parser.manager = manager;
+	parser.cursor = expression;
+	parser.stack_depth = 0;
+	parser.nesting = 0;
+
+	success = ConditionManager_ParseOr(&parser);
+
+	/* Make sure that the entire expression is processed! */
+	ConditionManager_SkipWhitespace(&parser);
+
+	if (!success || *parser.cursor != '\0')
+	{
+		/* Discard anything that was added by the failed compilation. */
+		manager->total_reads = total_reads;
+		manager->total_instructions = total_instructions;
+		return cc_false;
+	}
+
+	manager->conditions[manager->total_conditions].first_instruction = total_instructions;
+	manager->conditions[manager->total_conditions].total_instructions = manager->total_instructions - total_instructions;
+	manager->conditions[manager->total_conditions].result = cc_false;
+	manager->conditions[manager->total_conditions].previous_result = cc_false;
+
+	*index = manager->total_conditions++;
+
+	return cc_true;
+}
+
+void ConditionManager_ResetHits(ConditionManager* const manager, const unsigned int index)
+{
+	unsigned int i;
+
+	if (index >= manager->total_conditions)
+		return;
+
+	for (i = 0; i < manager->conditions[index].total_instructions; ++i)
+		manager->instructions[manager->conditions[index].first_instruction + i].hits = 0;
+}
+
+void ConditionManager_Evaluate(ConditionManager* const manager, const ClownMDEmu* const clownmdemu)
+{
+	unsigned int i;
+
+	/* Fetch every read once, up-front. */
+	for (i = 0; i < manager->total_reads; ++i)
+	{
+		const cc_u32f value = ConditionManager_FetchRead(clownmdemu->state.m68k.ram, &manager->reads[i]);
+
+		/* Newly-added reads have no history, so pretend that they were unchanged. */
+		manager->previous_values[i] = i < manager->total_primed_reads ? manager->current_values[i] : value;
+		manager->current_values[i] = value;
+	}
+
+	manager->total_primed_reads = manager->total_reads;
+
+	for (i = 0; i < manager->total_conditions; ++i)
+	{
+		manager->conditions[i].previous_result = manager->conditions[i].result;
+		manager->conditions[i].result = ConditionManager_Execute(manager, manager->conditions[i].first_instruction, manager->conditions[i].total_instructions);
+	}
+}
+
+cc_bool ConditionManager_IsTrue(const ConditionManager* const manager, const unsigned int index)
+{
+	return index < manager->total_conditions && manager->conditions[index].result;
+}
+
+cc_bool ConditionManager_BecameTrue(const ConditionManager* const manager, const unsigned int index)
+{
+	return ConditionManager_IsTrue(manager, index) && !manager->conditions[index].previous_result;
+}
@@ -0,0 +1,150 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_CONDITION_H
+#define CLOWNMDEMU_FRONTEND_COMMON_CONDITION_H
+
+#include "core/libraries/clowncommon/clowncommon.h"
+#include "core/source/clownmdemu.h"
+
+/* Condition expressions are compiled once into a flat array of instructions
+   which is then evaluated against RAM every frame. The syntax is as follows:
+
+   Memory:      b[FF1234], w[FF1234], l[FF1234]  (byte, word, and longword reads)
+   Delta:       db[FF1234], dw[FF1234], dl[FF1234]  (the value on the previous frame)
+   Constants:   123, 0x7B
+   Comparisons: == != < <= > >=
+   Hit counts:  w[FF0000] == 5 {60}  (true once the comparison has been true on 60 frames)
+   Groups:      && || ( )
+
+   Every comparison is evaluated every frame, so that hit counts accumulate
+   even when the outcome of the expression has already been decided. */
+
+#define CONDITIONMANAGER_MAXIMUM_CONDITIONS 0x100
+#define CONDITIONMANAGER_MAXIMUM_INSTRUCTIONS 0x1000
+#define CONDITIONMANAGER_MAXIMUM_READS 0x400
+#define CONDITIONMANAGER_MAXIMUM_STACK_DEPTH 0x20
+
+typedef enum ConditionManager_Opcode
+{
+	CONDITIONMANAGER_OPCODE_EQUAL,
+	CONDITIONMANAGER_OPCODE_NOT_EQUAL,
+	CONDITIONMANAGER_OPCODE_LESS,
+	CONDITIONMANAGER_OPCODE_LESS_OR_EQUAL,
+	CONDITIONMANAGER_OPCODE_GREATER,
+	CONDITIONMANAGER_OPCODE_GREATER_OR_EQUAL,
+	CONDITIONMANAGER_OPCODE_AND,
+	CONDITIONMANAGER_OPCODE_OR
+} ConditionManager_Opcode;
+
+typedef enum ConditionManager_OperandType
+{
+	CONDITIONMANAGER_OPERAND_CONSTANT,
+	CONDITIONMANAGER_OPERAND_CURRENT,
+	CONDITIONMANAGER_OPERAND_PREVIOUS
+} ConditionManager_OperandType;
+
+typedef enum ConditionManager_ReadSize
+{
+	CONDITIONMANAGER_READ_BYTE,
+	CONDITIONMANAGER_READ_WORD,
+	CONDITIONMANAGER_READ_LONGWORD
+} ConditionManager_ReadSize;
+
+typedef struct ConditionManager_Instruction
+{
+	cc_u8l opcode;
+	cc_u8l operand_types[2];
+	/* Either a constant or an index into the read table. */
+	cc_u32l operands[2];
+	/* 0 if the comparison has no hit count. */
+	cc_u32l hit_target;
+	cc_u32l hits;
+} ConditionManager_Instruction;
+
+typedef struct ConditionManager_Read
+{
+	/* In bytes, from the start of RAM. */
+	cc_u16l offset;
+	cc_u8l size;
+} ConditionManager_Read;
+
+typedef struct ConditionManager
+{
+	/* Reads are shared between every condition, so that each is only fetched once per frame. */
+	ConditionManager_Read reads[CONDITIONMANAGER_MAXIMUM_READS];
+	cc_u32l current_values[CONDITIONMANAGER_MAXIMUM_READS];
+	cc_u32l previous_values[CONDITIONMANAGER_MAXIMUM_READS];
+	unsigned int total_reads;
+	/* Reads past this point have not been fetched yet, so have no previous value. */
+	unsigned int total_primed_reads;
+
+	ConditionManager_Instruction instructions[CONDITIONMANAGER_MAXIMUM_INSTRUCTIONS];
+	unsigned int total_instructions;
+
+	struct
+	{
+		unsigned int first_instruction, total_instructions;
+		cc_bool result, previous_result;
+	} conditions[CONDITIONMANAGER_MAXIMUM_CONDITIONS];
+
+	unsigned int total_conditions;
+} ConditionManager;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ConditionManager_Initialise(ConditionManager *manager);
+void ConditionManager_ResetConditions(ConditionManager *manager);
+cc_bool ConditionManager_AddCondition(ConditionManager *manager, const char *expression, unsigned int *index);
+void ConditionManager_ResetHits(ConditionManager *manager, unsigned int index);
+void ConditionManager_Evaluate(ConditionManager *manager, const ClownMDEmu *clownmdemu);
+cc_bool ConditionManager_IsTrue(const ConditionManager *manager, unsigned int index);
+cc_bool ConditionManager_BecameTrue(const ConditionManager *manager, unsigned int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+class ConditionManagerCXX : private ConditionManager
+{
+public:
+	ConditionManagerCXX()
+	{
+		ConditionManager_Initialise(this);
+	}
+
+	void ResetConditions()
+	{
+		ConditionManager_ResetConditions(this);
+	}
+
+	bool AddCondition(const char* const expression, unsigned int* const index)
+	{
+		return ConditionManager_AddCondition(this, expression, index);
+	}
+
+	void ResetHits(const unsigned int index)
+	{
+		ConditionManager_ResetHits(this, index);
+	}
+
+	void Evaluate(const ClownMDEmu* const clownmdemu)
+	{
+		ConditionManager_Evaluate(this, clownmdemu);
+	}
+
+	bool IsTrue(const unsigned int index) const
+	{
+		return ConditionManager_IsTrue(this, index);
+	}
+
+	bool BecameTrue(const unsigned int index) const
+	{
+		return ConditionManager_BecameTrue(this, index);
+	}
+};
+
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_CONDITION_H */
@@ -0,0 +1,21 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_CRC32_H
+#define CLOWNMDEMU_FRONTEND_COMMON_CRC32_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+
+/* The standard CRC-32 used by zlib, PNG, IPS/UPS/BPS, and the like.
+   Pass 0 as the initial value, and pass the result of the previous call to continue. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cc_u32f CRC32_Update(cc_u32f crc, const unsigned char *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_CRC32_H */
@@ -0,0 +1,154 @@
+#include "delta.h"
+
+#include <stddef.h>
+
+/* Runs of unchanged bytes shorter than this are cheaper to store as literals. */
+#define DELTA_CHUNK_SIZE 16
+
+/* These are simple enough that the compiler will vectorise them. */
+
+static cc_bool Delta_ChunkIsUnchanged(const unsigned char* const data, const unsigned char* const reference)
+{
+	cc_u8f difference = 0;
+	cc_u8f i;
+
+	if (reference == NULL)
+	{
+		for (i = 0; i < DELTA_CHUNK_SIZE; ++i)
+			difference |= data[i];
+	}
+	else
+	{
+		for (i = 0; i < DELTA_CHUNK_SIZE; ++i)
+			difference |= data[i] ^ reference[i];
+	}
+
+	return difference == 0;
+}
+
+static cc_bool Delta_ByteIsUnchanged(const unsigned char* const data, const unsigned char* const reference, const size_t index)
+{
+	return data[index] == (reference == NULL ? 0 : reference[index]);
+}
+
+static unsigned char* Delta_WriteNumber(unsigned char *output, size_t value)
+{
+	/* Seven bits at a time, with the high bit marking that more follow. */
+	while (value >= 0x80)
+	{
+		*output++ = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+
+	*output++ = value;
+
+	return output;
+}
+
+static cc_bool Delta_ReadNumber(const unsigned char** const input, const unsigned char* const input_end, size_t* const value)
+{
+	cc_u8f shift = 0;
+
+	*value = 0;
+
+	for (;;)
+	{
+		unsigned char byte;
+
+		if (*input == input_end || shift >= sizeof(size_t) * 8)
+			return cc_false;
+
+		byte = *(*input)++;
+		*value |= (size_t)(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0)
+			return cc_true;
+
+		shift += 7;
+	}
+}
+
+size_t Delta_Encode(unsigned char* const output, const void* const data_pointer, const void* const reference_pointer, const size_t size)
+{
+	const unsigned char* const data = (const unsigned char*)data_pointer;
+	const unsigned char* const reference = (const unsigned char*)reference_pointer;
+
+	unsigned char *output_pointer = output;
+	size_t position = 0;
+
+	/* The data is encoded as pairs of runs: unchanged bytes, followed by changed bytes. */
+	while (position != size)
+	{
+		const size_t unchanged_start = position;
+
+		size_t changed_start, i;
+
+		while (size - position >= DELTA_CHUNK_SIZE && Delta_ChunkIsUnchanged(&data[position], reference == NULL ? NULL : &reference[position]))
+			position += DELTA_CHUNK_SIZE;
+
+		while (position != size && Delta_ByteIsUnchanged(data, reference, position))
+			++position;
+
+		changed_start = position;
+
+		/* End the changed run at the next unchanged chunk. This may leave some unchanged bytes in it,
+		   but that is better than the overhead of starting a new pair of runs. Because of this, each
+		   new pair of runs removes at least a chunk, which outweighs the size of its header. */
+		while (position != size)
+		{
+			if (size - position < DELTA_CHUNK_SIZE)
+				position = size;
+			else if (Delta_ChunkIsUnchanged(&data[position], reference == NULL ? NULL : &reference[position]))
+				break;
+			else
+				position += DELTA_CHUNK_SIZE;
+		}
+
+		output_pointer = Delta_WriteNumber(output_pointer, changed_start - unchanged_start);
+		output_pointer = Delta_WriteNumber(output_pointer, position - changed_start);
+
+		if (reference == NULL)
+		{
+			for (i = changed_start; i < position; ++i)
+				*output_pointer++ = data[i];
+		}
+		else
+		{
+			for (i = changed_start; i < position; ++i)
+				*output_pointer++ = data[i] ^ reference[i];
+		}
+	}
+
+	return output_pointer - output;
+}
+
+size_t Delta_Decode(void* const data_pointer, const size_t size, const unsigned char* const encoded, const size_t encoded_size)
+{
+	unsigned char* const data = (unsigned char*)data_pointer;
+	const unsigned char *input = encoded;
+	const unsigned char* const input_end = encoded + encoded_size;
+
+	size_t position = 0;
+
+	while (position != size)
+	{
+		size_t unchanged_length, changed_length, i;
+
+		if (!Delta_ReadNumber(&input, input_end, &unchanged_length) || !Delta_ReadNumber(&input, input_end, &changed_length))
+			return 0;
+
+		if (unchanged_length > size - position || changed_length > size - position - unchanged_length || changed_length > (size_t)(input_end - input))
+			return 0;
+
+		/* Unchanged bytes do not need to be touched at all. */
+		position += unchanged_length;
+
+		for (i = 0; i < changed_length; ++i)
+			data[position + i] ^= input[i];
+
+		input += changed_length;
+		position += changed_length;
+	}
+
+	return input - encoded;
+}
@@ -0,0 +1,28 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_DELTA_H
+#define CLOWNMDEMU_FRONTEND_COMMON_DELTA_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+
+/* A simple, fast compression format for blocks of data which are mostly identical to a reference block,
+   such as consecutive save states. The data is XORed with the reference, and runs of zeroes are skipped.
+   Without a reference, this just compresses runs of zeroes, which emulator state has plenty of.
+
+   Since XOR is its own inverse, decoding into the data converts it to the reference and vice versa. */
+
+/* The encoder never expands data by more than this. */
+#define DELTA_MAXIMUM_ENCODED_SIZE(SIZE) ((SIZE) + 16)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t Delta_Encode(unsigned char *output, const void *data, const void *reference, size_t size);
+size_t Delta_Decode(void *data, size_t size, const unsigned char *encoded, size_t encoded_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_DELTA_H */
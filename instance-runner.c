@@ -0,0 +1,188 @@
+#include "instance-runner.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mixer.h"
+#include "profiler.h"
+
+/* Instances are claimed by atomically incrementing a worker's 'next_instance', which works the same whether it
+   is the worker's own or one being stolen, so no locking is needed. Without atomics, only one worker can be used. */
+#if defined(__GNUC__)
+#define INSTANCERUNNER_ATOMIC_FETCH_ADD(VARIABLE, VALUE) __atomic_fetch_add(&(VARIABLE), VALUE, __ATOMIC_RELAXED)
+#define INSTANCERUNNER_HAS_ATOMICS cc_true
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define INSTANCERUNNER_ATOMIC_FETCH_ADD(VARIABLE, VALUE) _InterlockedExchangeAdd(&(VARIABLE), VALUE)
+#define INSTANCERUNNER_HAS_ATOMICS cc_true
+#else
+#define INSTANCERUNNER_ATOMIC_FETCH_ADD(VARIABLE, VALUE) ((VARIABLE) += (VALUE), (VARIABLE) - (VALUE))
+#define INSTANCERUNNER_HAS_ATOMICS cc_false
+#endif
+
+static cc_bool InstanceRunner_ClaimInstance(InstanceRunner_Worker* const worker, size_t* const instance_index)
+{
+	const long index = INSTANCERUNNER_ATOMIC_FETCH_ADD(worker->next_instance, 1);
+
+	if (index >= worker->end_instance)
+		return cc_false;
+
+	*instance_index = (size_t)index;
+	return cc_true;
+}
+
+static void InstanceRunner_RunInstance(InstanceRunner_State* const state, InstanceRunner_Worker* const worker, const size_t instance_index)
+{
+	/* Neighbouring instances are often run by different workers, so the statistics are gathered here
+	   and written once at the end, rather than having the workers fight over the cache lines every frame. */
+	InstanceRunner_InstanceStatistics statistics = state->instance_statistics[instance_index];
+	unsigned int i;
+
+	for (i = 0; i < state->frames_per_batch; ++i)
+	{
+		const cc_u32f start = Profiler_GetTime();
+		unsigned long duration;
+
+		state->callback((void*)state->user_data, instance_index, worker->mixer);
+
+		duration = Profiler_GetMicrosecondsSince(start);
+
+		++statistics.total_frames;
+		statistics.last_frame_microseconds = duration;
+		statistics.worst_frame_microseconds = CC_MAX(statistics.worst_frame_microseconds, duration);
+		statistics.total_microseconds += duration;
+	}
+
+	state->instance_statistics[instance_index] = statistics;
+}
+
+static void InstanceRunner_FreeMixers(InstanceRunner_State* const state, const unsigned int total_mixers)
+{
+	unsigned int i;
+
+	for (i = 0; i < total_mixers; ++i)
+	{
+		Mixer_Deinitialise(state->workers[i].worker.mixer);
+		free(state->workers[i].worker.mixer);
+	}
+}
+
+cc_bool InstanceRunner_Initialise(InstanceRunner_State* const state, const size_t total_instances, const unsigned int total_workers, const cc_bool mix_audio, const cc_bool pal_mode, const InstanceRunner_FrameCallback callback, const void* const user_data)
+{
+	unsigned int i;
+
+	if (total_workers == 0 || (!INSTANCERUNNER_HAS_ATOMICS && total_workers > 1))
+		return cc_false;
+
+	state->callback = callback;
+	state->user_data = user_data;
+	state->total_instances = total_instances;
+	state->total_workers = total_workers;
+	state->frames_per_batch = 0;
+	state->batch_start = 0;
+	memset(&state->statistics, 0, sizeof(state->statistics));
+
+	state->instance_statistics = (InstanceRunner_InstanceStatistics*)calloc(total_instances == 0 ? 1 : total_instances, sizeof(*state->instance_statistics));
+	state->workers = (InstanceRunner_PaddedWorker*)calloc(total_workers, sizeof(*state->workers));
+
+	if (state->instance_statistics == NULL || state->workers == NULL)
+	{
+		free(state->instance_statistics);
+		free(state->workers);
+		return cc_false;
+	}
+
+	if (mix_audio)
+	{
+		for (i = 0; i < total_workers; ++i)
+		{
+			Mixer_State* const mixer = (Mixer_State*)malloc(sizeof(Mixer_State));
+
+			if (mixer == NULL || !Mixer_Initialise(mixer, pal_mode))
+			{
+				free(mixer);
+				InstanceRunner_FreeMixers(state, i);
+				free(state->instance_statistics);
+				free(state->workers);
+				return cc_false;
+			}
+
+			state->workers[i].worker.mixer = mixer;
+		}
+	}
+
+	return cc_true;
+}
+
+void InstanceRunner_Deinitialise(InstanceRunner_State* const state)
+{
+	if (state->workers[0].worker.mixer != NULL)
+		InstanceRunner_FreeMixers(state, state->total_workers);
+
+	free(state->instance_statistics);
+	free(state->workers);
+}
+
+void InstanceRunner_BeginBatch(InstanceRunner_State* const state, const unsigned int frames)
+{
+	unsigned int i;
+
+	state->frames_per_batch = frames;
+
+	/* Give each worker an even share of the instances to begin with. */
+	for (i = 0; i < state->total_workers; ++i)
+	{
+		InstanceRunner_Worker* const worker = &state->workers[i].worker;
+
+		worker->next_instance = (long)(state->total_instances * i / state->total_workers);
+		worker->end_instance = (long)(state->total_instances * (i + 1) / state->total_workers);
+		worker->instances_stolen = 0;
+	}
+
+	state->batch_start = Profiler_GetTime();
+}
+
+void InstanceRunner_Work(InstanceRunner_State* const state, const unsigned int worker_index)
+{
+	InstanceRunner_Worker* const worker = &state->workers[worker_index].worker;
+	size_t instance_index;
+	unsigned int i;
+
+	while (InstanceRunner_ClaimInstance(worker, &instance_index))
+		InstanceRunner_RunInstance(state, worker, instance_index);
+
+	/* Out of work, so help the others. Nothing gets added during a batch, so one pass is enough. */
+	for (i = 1; i < state->total_workers; ++i)
+	{
+		InstanceRunner_Worker* const victim = &state->workers[(worker_index + i) % state->total_workers].worker;
+
+		while (InstanceRunner_ClaimInstance(victim, &instance_index))
+		{
+			InstanceRunner_RunInstance(state, worker, instance_index);
+			++worker->instances_stolen;
+		}
+	}
+}
+
+void InstanceRunner_EndBatch(InstanceRunner_State* const state)
+{
+	unsigned int i;
+
+	state->statistics.total_frames = (unsigned long)state->total_instances * state->frames_per_batch;
+	state->statistics.microseconds = Profiler_GetMicrosecondsSince(state->batch_start);
+	state->statistics.frames_per_second = state->statistics.microseconds == 0 ? 0 : (unsigned long)((double)state->statistics.total_frames * 1000000 / state->statistics.microseconds);
+	state->statistics.instances_stolen = 0;
+
+	for (i = 0; i < state->total_workers; ++i)
+		state->statistics.instances_stolen += state->workers[i].worker.instances_stolen;
+}
+
+const InstanceRunner_Statistics* InstanceRunner_GetStatistics(const InstanceRunner_State* const state)
+{
+	return &state->statistics;
+}
+
+const InstanceRunner_InstanceStatistics* InstanceRunner_GetInstanceStatistics(const InstanceRunner_State* const state, const size_t instance_index)
+{
+	return &state->instance_statistics[instance_index];
+}
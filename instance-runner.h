@@ -0,0 +1,189 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_INSTANCE_RUNNER_H
+#define CLOWNMDEMU_FRONTEND_COMMON_INSTANCE_RUNNER_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+
+/* Runs many independent emulators in one process, spread across a pool of
+   worker threads, for things like automated testing.
+
+   The frontend creates the threads, and the runner decides what they do. To
+   emulate a batch of frames, call 'InstanceRunner_BeginBatch', have every
+   worker thread call 'InstanceRunner_Work' with its own index, wait for them
+   all to return, and then call 'InstanceRunner_EndBatch'. Within a batch, each
+   instance is run by a single worker, which emulates all of its frames in one
+   go, so the frontend's per-instance data never needs locking.
+
+   The instances start out divided evenly between the workers. Workers which
+   run out of instances steal them from the others, so that a few slow
+   instances do not leave the rest of the threads idle.
+
+   A frame's audio is only held by the mixer between 'Mixer_Begin' and
+   'Mixer_End', so, rather than every instance having its own, each worker has
+   a mixer which it lends to whichever instance it is running. This means that
+   the time-stretching fast-forward mode, which carries audio over between
+   frames, cannot be used with them.
+
+   Emulators running the same disc can share a 'SectorCache'.
+
+   Work is shared between the workers with atomic operations, so, on compilers
+   which the runner does not know how to do those with, only one worker can be
+   used. */
+
+/* 'mixer.h' is not included here, since it may contain its implementation. */
+struct Mixer_State;
+
+/* Called to emulate a single frame of an instance. 'mixer' is NULL if audio is disabled. */
+typedef void (*InstanceRunner_FrameCallback)(void *user_data, size_t instance_index, struct Mixer_State *mixer);
+
+/* Enough for the cache lines of common CPUs. */
+#define INSTANCERUNNER_CACHE_LINE_SIZE 64
+
+typedef struct InstanceRunner_InstanceStatistics
+{
+	unsigned long total_frames;
+	unsigned long last_frame_microseconds;
+	unsigned long worst_frame_microseconds;
+	/* This would overflow 32 bits after about 71 minutes, which long-running tests can exceed. */
+	double total_microseconds;
+} InstanceRunner_InstanceStatistics;
+
+typedef struct InstanceRunner_Statistics
+{
+	/* These are for the last batch. */
+	unsigned long total_frames;
+	unsigned long microseconds;
+	unsigned long frames_per_second;
+	unsigned long instances_stolen;
+} InstanceRunner_Statistics;
+
+typedef struct InstanceRunner_Worker
+{
+	/* The instances which have not been started yet. Other workers take from this too, when stealing. */
+	long next_instance, end_instance;
+	struct Mixer_State *mixer;
+	unsigned long instances_stolen;
+} InstanceRunner_Worker;
+
+/* Every worker constantly writes to its own 'InstanceRunner_Worker', so they are kept in separate cache lines.
+   Padding them to two lines apart guarantees this without needing the array to be aligned. */
+typedef union InstanceRunner_PaddedWorker
+{
+	InstanceRunner_Worker worker;
+	unsigned char padding[INSTANCERUNNER_CACHE_LINE_SIZE * 2];
+} InstanceRunner_PaddedWorker;
+
+typedef struct InstanceRunner_State
+{
+	InstanceRunner_FrameCallback callback;
+	const void *user_data;
+
+	size_t total_instances;
+	InstanceRunner_InstanceStatistics *instance_statistics;
+
+	unsigned int total_workers;
+	InstanceRunner_PaddedWorker *workers;
+
+	unsigned int frames_per_batch;
+	cc_u32l batch_start;
+	InstanceRunner_Statistics statistics;
+} InstanceRunner_State;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cc_bool InstanceRunner_Initialise(InstanceRunner_State *state, size_t total_instances, unsigned int total_workers, cc_bool mix_audio, cc_bool pal_mode, InstanceRunner_FrameCallback callback, const void *user_data);
+void InstanceRunner_Deinitialise(InstanceRunner_State *state);
+void InstanceRunner_BeginBatch(InstanceRunner_State *state, unsigned int frames);
+void InstanceRunner_Work(InstanceRunner_State *state, unsigned int worker_index);
+void InstanceRunner_EndBatch(InstanceRunner_State *state);
+const InstanceRunner_Statistics* InstanceRunner_GetStatistics(const InstanceRunner_State *state);
+const InstanceRunner_InstanceStatistics* InstanceRunner_GetInstanceStatistics(const InstanceRunner_State *state, size_t instance_index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+class InstanceRunner
+{
+protected:
+	InstanceRunner_State state;
+	bool initialised;
+
+public:
+	typedef InstanceRunner_FrameCallback FrameCallback;
+	typedef InstanceRunner_Statistics Statistics;
+	typedef InstanceRunner_InstanceStatistics InstanceStatistics;
+
+	InstanceRunner(const std::size_t total_instances, const unsigned int total_workers, const bool mix_audio, const bool pal_mode, const FrameCallback callback, const void* const user_data)
+	{
+		initialised = InstanceRunner_Initialise(&state, total_instances, total_workers, mix_audio, pal_mode, callback, user_data);
+	}
+	InstanceRunner(const InstanceRunner &other) = delete;
+	InstanceRunner(InstanceRunner &&other)
+		: state(other.state)
+		, initialised(other.initialised)
+	{
+		other.initialised = false;
+	}
+	InstanceRunner& operator=(const InstanceRunner &other) = delete;
+	InstanceRunner& operator=(InstanceRunner &&other)
+	{
+		std::swap(state, other.state);
+		std::swap(initialised, other.initialised);
+		return *this;
+	}
+
+	~InstanceRunner()
+	{
+		if (initialised)
+			InstanceRunner_Deinitialise(&state);
+	}
+
+	bool Initialised() const
+	{
+		return initialised;
+	}
+
+	void BeginBatch(const unsigned int frames)
+	{
+		assert(Initialised());
+		InstanceRunner_BeginBatch(&state, frames);
+	}
+
+	void Work(const unsigned int worker_index)
+	{
+		assert(Initialised());
+		InstanceRunner_Work(&state, worker_index);
+	}
+
+	void EndBatch()
+	{
+		assert(Initialised());
+		InstanceRunner_EndBatch(&state);
+	}
+
+	const Statistics& GetStatistics() const
+	{
+		assert(Initialised());
+		return *InstanceRunner_GetStatistics(&state);
+	}
+
+	const InstanceStatistics& GetInstanceStatistics(const std::size_t instance_index) const
+	{
+		assert(Initialised());
+		return *InstanceRunner_GetInstanceStatistics(&state, instance_index);
+	}
+};
+
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_INSTANCE_RUNNER_H */
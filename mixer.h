@@ -16,6 +16,12 @@
 #define MIXER_TO_FIXED_POINT_FROM_INTEGER(X) ((X) * MIXER_FIXED_POINT_FRACTIONAL_SIZE)
 #define MIXER_FIXED_POINT_MULTIPLY(MULTIPLICAND, MULTIPLIER) ((MULTIPLICAND) * (MULTIPLIER) / MIXER_FIXED_POINT_FRACTIONAL_SIZE)
 
+/* These are in output frames. */
+#define MIXER_TIME_STRETCH_OVERLAP 512
+#define MIXER_TIME_STRETCH_SEARCH 512
+/* Only every nth offset and frame is compared when searching, to keep it cheap. */
+#define MIXER_TIME_STRETCH_SEARCH_STEP 8
+
 typedef struct Mixer_Source
 {
 	cc_u8f channels;
@@ -38,12 +44,51 @@ enum
 	MIXER_SOURCE_TOTAL
 };
 
+enum
+{
+	/* Mix every frame as normal. */
+	MIXER_FAST_FORWARD_OFF,
+	/* Do not mix at all; the callback is never called. */
+	MIXER_FAST_FORWARD_MUTE,
+	/* Mix only a slice of each frame, and splice the slices together so that
+	   one frame's worth of audio is output for every 'speed' frames, without
+	   raising the pitch. */
+	MIXER_FAST_FORWARD_TIME_STRETCH
+};
+
+typedef struct Mixer_TimeStretch
+{
+	/* Slices are gathered here until there is a frame's worth of them. */
+	cc_s16l buffer[MIXER_MAXIMUM_AUDIO_FRAMES_PER_FRAME * 2 * MIXER_CHANNEL_COUNT];
+	size_t total_frames;
+	/* The audio which followed the last slice, which the next slice fades in from. */
+	cc_s16l tail[MIXER_TIME_STRETCH_OVERLAP * MIXER_CHANNEL_COUNT];
+	size_t total_tail_frames;
+} Mixer_TimeStretch;
+
+typedef void (*Mixer_Callback)(void *user_data, const cc_s16l *audio_samples, size_t total_frames);
+
 typedef struct Mixer_State
 {
 	Mixer_Source sources[MIXER_SOURCE_TOTAL];
+	cc_u8f fast_forward_mode, fast_forward_speed;
+	Mixer_TimeStretch time_stretch;
+
+	/* In pipelined mode, 'Mixer_End' swaps the emulator's sources with these and leaves them for a worker
+	   thread to mix with 'Mixer_MixPending', while the emulator moves on to the next frame. Each counter is
+	   only ever written by one thread: 'frames_published' by the emulator, and 'frames_mixed' by the worker.
+	   The callback is called by the worker, so its user data must stay valid until the frame has been mixed,
+	   which is guaranteed by the time that the next 'Mixer_End' or 'Mixer_DisablePipelining' returns. */
+	cc_bool pipelined;
+	Mixer_Source pending_sources[MIXER_SOURCE_TOTAL];
+	Mixer_Callback pending_callback;
+	const void *pending_user_data;
+	long frames_published, frames_mixed;
 } Mixer_State;
 
-typedef void (*Mixer_Callback)(void *user_data, const cc_s16l *audio_samples, size_t total_frames);
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 cc_bool Mixer_Initialise(Mixer_State *state, cc_bool pal_mode);
 void Mixer_Deinitialise(Mixer_State *state);
@@ -53,11 +98,20 @@ cc_s16l* Mixer_AllocatePSGSamples(Mixer_State *state, size_t total_frames);
 cc_s16l* Mixer_AllocatePCMSamples(Mixer_State *state, size_t total_frames);
 cc_s16l* Mixer_AllocateCDDASamples(Mixer_State *state, size_t total_frames);
 void Mixer_End(Mixer_State *state, Mixer_Callback callback, const void *user_data);
+void Mixer_SetFastForward(Mixer_State *state, cc_u8f mode, cc_u8f speed);
+cc_bool Mixer_EnablePipelining(Mixer_State *state);
+void Mixer_DisablePipelining(Mixer_State *state);
+cc_bool Mixer_MixPending(Mixer_State *state);
+
+#ifdef __cplusplus
+}
+#endif
 
 #ifdef __cplusplus
 
 #include <cassert>
 #include <cstddef>
+#include <utility>
 #if CC_CPLUSPLUS >= 201103L
 #include <functional>
 #endif
@@ -68,6 +122,21 @@ protected:
 	Mixer_State state;
 	bool initialised;
 
+#if CC_CPLUSPLUS >= 201103L
+	using CallbackFunctionalStorage = std::function<void(const cc_s16l *audio_samples, std::size_t total_frames)>;
+	/* In pipelined mode, the callback is called after 'End' returns, so it must be copied. One copy is
+	   being filled in while the worker may still be using the other, so they take turns. */
+	CallbackFunctionalStorage pending_callbacks[2];
+
+	/* A pending frame's user data points at one of 'other's callbacks, which have been moved into this one. */
+	void AdoptPendingCallback(const Mixer &other)
+	{
+		for (cc_u8f i = 0; i < CC_COUNT_OF(pending_callbacks); ++i)
+			if (state.pending_user_data == &other.pending_callbacks[i])
+				state.pending_user_data = &pending_callbacks[i];
+	}
+#endif
+
 public:
 	typedef Mixer_Callback Callback;
 
@@ -76,18 +145,35 @@ public:
 		initialised = Mixer_Initialise(&state, pal_mode);
 	}
 	Mixer(const Mixer &other) = delete;
+	/* In pipelined mode, a mixer must not be moved while a worker thread may be calling 'MixPending' on it,
+	   since the worker holds onto its state. A frame which is still pending is moved along with it. */
 	Mixer(Mixer &&other)
 		: state(other.state)
 		, initialised(other.initialised)
+#if CC_CPLUSPLUS >= 201103L
+		, pending_callbacks{std::move(other.pending_callbacks[0]), std::move(other.pending_callbacks[1])}
+#endif
 	{
 		for (cc_u8f i = 0; i < CC_COUNT_OF(other.state.sources); ++i)
+		{
 			other.state.sources[i].buffer = NULL;
+			other.state.pending_sources[i].buffer = NULL;
+		}
+
+#if CC_CPLUSPLUS >= 201103L
+		AdoptPendingCallback(other);
+#endif
 	}
 	Mixer& operator=(const Mixer &other) = delete;
 	Mixer& operator=(Mixer &&other)
 	{
 		std::swap(state, other.state);
 		std::swap(initialised, other.initialised);
+#if CC_CPLUSPLUS >= 201103L
+		std::swap(pending_callbacks, other.pending_callbacks);
+		AdoptPendingCallback(other);
+		other.AdoptPendingCallback(*this);
+#endif
 		return *this;
 	}
 
@@ -138,16 +224,50 @@ public:
 		Mixer_End(&state, callback, user_data);
 	}
 
+	void SetFastForward(const cc_u8f mode, const cc_u8f speed)
+	{
+		assert(Initialised());
+		Mixer_SetFastForward(&state, mode, speed);
+	}
+
+	bool EnablePipelining()
+	{
+		assert(Initialised());
+		return Mixer_EnablePipelining(&state);
+	}
+
+	void DisablePipelining()
+	{
+		assert(Initialised());
+		Mixer_DisablePipelining(&state);
+	}
+
+	bool MixPending()
+	{
+		assert(Initialised());
+		return Mixer_MixPending(&state);
+	}
+
 #if CC_CPLUSPLUS >= 201103L
-	using CallbackFunctional = std::function<void(const cc_s16l *audio_samples, std::size_t total_frames)>;
+	using CallbackFunctional = CallbackFunctionalStorage;
 	void End(const CallbackFunctional &callback)
 	{
+		const CallbackFunctional *callback_pointer = &callback;
+
+		/* Only this thread modifies 'frames_published', so it is safe to read. */
+		if (state.pipelined)
+		{
+			CallbackFunctional &pending_callback = pending_callbacks[state.frames_published % 2];
+			pending_callback = callback;
+			callback_pointer = &pending_callback;
+		}
+
 		End(
 			[](void* const user_data, const cc_s16l* const audio_samples, const std::size_t total_frames)
 			{
 				const auto &callback = *static_cast<const CallbackFunctional*>(user_data);
 				callback(audio_samples, total_frames);
-			}, &callback
+			}, callback_pointer
 		);
 	}
 #endif
@@ -159,6 +279,8 @@ public:
 
 #ifdef MIXER_IMPLEMENTATION
 
+#include "profiler.h"
+
 #ifndef MIXER_ASSERT
 #include <assert.h>
 #define MIXER_ASSERT assert
@@ -184,6 +306,43 @@ public:
 #define MIXER_MEMSET memset
 #endif
 
+/* These must have acquire and release semantics respectively. Define both to override them. */
+#ifndef MIXER_ATOMIC_LOAD
+#if defined(__GNUC__)
+#define MIXER_ATOMIC_LOAD(VARIABLE) __atomic_load_n(&(VARIABLE), __ATOMIC_ACQUIRE)
+#define MIXER_ATOMIC_STORE(VARIABLE, VALUE) __atomic_store_n(&(VARIABLE), VALUE, __ATOMIC_RELEASE)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define MIXER_ATOMIC_LOAD(VARIABLE) _InterlockedCompareExchange(&(VARIABLE), 0, 0)
+#define MIXER_ATOMIC_STORE(VARIABLE, VALUE) _InterlockedExchange(&(VARIABLE), VALUE)
+#else
+/* This is only safe on platforms which do not reorder memory accesses. */
+#define MIXER_ATOMIC_LOAD(VARIABLE) (*(volatile long*)&(VARIABLE))
+#define MIXER_ATOMIC_STORE(VARIABLE, VALUE) (*(volatile long*)&(VARIABLE) = (VALUE))
+#endif
+#endif
+
+/* Called while waiting for the worker thread to catch up, to give it the CPU. */
+#ifndef MIXER_YIELD
+#if defined(_WIN32)
+/* Keep 'windows.h' from defining 'min' and 'max' macros, which break 'std::min' and 'std::max' in C++ frontends. */
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define MIXER_YIELD() SwitchToThread()
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sched.h>
+#define MIXER_YIELD() sched_yield()
+#else
+/* Without a way to yield, this just spins. Define MIXER_YIELD to avoid this. */
+#define MIXER_YIELD() ((void)0)
+#endif
+#endif
+
 /* Mixer Source */
 
 static cc_bool Mixer_Source_Initialise(Mixer_Source* const source, const cc_u8f channels, const cc_u32f input_sample_rate)
@@ -231,15 +390,6 @@ static size_t Mixer_Source_GetTotalAllocatedFrames(const Mixer_Source* const sou
 	return source->write_index;
 }
 
-static cc_s16l* Mixer_Source_GetFrame(Mixer_Source* const source, const cc_u32f position)
-{
-	const cc_u8f total_channels = source->channels;
-	const cc_u32f position_integral = position / MIXER_FIXED_POINT_FRACTIONAL_SIZE;
-	const cc_u32f frame_position = position_integral * total_channels;
-
-	return &source->buffer[frame_position];
-}
-
 /* Mixer API */
 
 static cc_u32f Mixer_GetCorrectedSampleRate(const cc_u32f sample_rate_ntsc, const cc_u32f sample_rate_pal, const cc_bool pal_mode)
@@ -274,7 +424,12 @@ cc_bool Mixer_Initialise(Mixer_State* const state, const cc_bool pal_mode)
 	}
 
 	if (success)
+	{
+		state->pipelined = cc_false;
+		state->frames_published = state->frames_mixed = 0;
+		Mixer_SetFastForward(state, MIXER_FAST_FORWARD_OFF, 1);
 		return cc_true;
+	}
 
 	for (i = 0; i < CC_COUNT_OF(state->sources); ++i)
 		if (successes[i])
@@ -288,7 +443,12 @@ void Mixer_Deinitialise(Mixer_State* const state)
 	cc_u8f i;
 
 	for (i = 0; i < CC_COUNT_OF(state->sources); ++i)
+	{
 		Mixer_Source_Deinitialise(&state->sources[i]);
+
+		if (state->pipelined)
+			Mixer_Source_Deinitialise(&state->pending_sources[i]);
+	}
 }
 
 void Mixer_Begin(Mixer_State* const state)
@@ -314,65 +474,331 @@ cc_s16l* Mixer_AllocatePCMSamples(Mixer_State* const state, const size_t total_f
 	return Mixer_Source_AllocateFrames(&state->sources[MIXER_SOURCE_PCM], total_frames);
 }
 
+/* The core hands this buffer straight to its CD audio reading callback, so, if that callback
+   calls 'CDReader_ReadAudio' with it, then the audio is decoded directly into the mixer. */
 cc_s16l* Mixer_AllocateCDDASamples(Mixer_State* const state, const size_t total_frames)
 {
 	return Mixer_Source_AllocateFrames(&state->sources[MIXER_SOURCE_CDDA], total_frames);
 }
 
-void Mixer_End(Mixer_State* const state, const Mixer_Callback callback, const void* const user_data)
+/* Mixing kernels */
+
+/* Each kernel is specialised for a particular set of sources, with their channel counts and volumes known at
+   compile-time, so that the inner loop has no branches, and its multiplications and divisions become bit-shifts. */
+/* Beware: This code assumes that the sources are stereo! */
+#define MIXER_DO_SOURCE(SOURCE, CHANNEL_COUNT, VOLUME_DIVISOR) \
+	{ \
+		const cc_s16l* const input_frame = &sources[SOURCE].buffer[position[SOURCE] / MIXER_FIXED_POINT_FRACTIONAL_SIZE * (CHANNEL_COUNT)]; \
+\
+		for (i = 0; i < CC_COUNT_OF(frame); ++i) \
+			frame[i] += input_frame[i] / (VOLUME_DIVISOR); \
+\
+		position[SOURCE] += ratio[SOURCE]; \
+	}
+
+#define MIXER_DEFINE_KERNEL(NAME, FM, PCM, CDDA) \
+static void NAME(const Mixer_Source* const sources, cc_s16l *output_buffer_pointer, const size_t total_frames, cc_u32f* const position, const cc_u32f* const ratio) \
+{ \
+	const cc_s16l* const psg_buffer = sources[MIXER_SOURCE_PSG].buffer; \
+	size_t frame_index; \
+\
+	for (frame_index = 0; frame_index < total_frames; ++frame_index) \
+	{ \
+		/* Mix the FM, PSG, PCM, and CDDA to produce the final audio. */ \
+		const cc_s16l psg_sample = psg_buffer[frame_index * CLOWNMDEMU_PSG_CHANNEL_COUNT] / CLOWNMDEMU_PSG_VOLUME_DIVISOR; \
+\
+		cc_s32f frame[MIXER_CHANNEL_COUNT]; \
+		cc_u8f i; \
+\
+		for (i = 0; i < CC_COUNT_OF(frame); ++i) \
+			frame[i] = psg_sample; \
+\
+		if (FM) \
+			MIXER_DO_SOURCE(MIXER_SOURCE_FM,   CLOWNMDEMU_FM_CHANNEL_COUNT,   CLOWNMDEMU_FM_VOLUME_DIVISOR  ); \
+		if (PCM) \
+			MIXER_DO_SOURCE(MIXER_SOURCE_PCM,  CLOWNMDEMU_PCM_CHANNEL_COUNT,  CLOWNMDEMU_PCM_VOLUME_DIVISOR ); \
+		if (CDDA) \
+			MIXER_DO_SOURCE(MIXER_SOURCE_CDDA, CLOWNMDEMU_CDDA_CHANNEL_COUNT, CLOWNMDEMU_CDDA_VOLUME_DIVISOR); \
+\
+		/* Clamp output to S16 sample range. */ \
+		for (i = 0; i < CC_COUNT_OF(frame); ++i) \
+			*output_buffer_pointer++ = CC_CLAMP(-0x7FFF, 0x7FFF, frame[i]); \
+	} \
+}
+
+MIXER_DEFINE_KERNEL(Mixer_Kernel_PSG,              0, 0, 0)
+MIXER_DEFINE_KERNEL(Mixer_Kernel_PSG_FM,           1, 0, 0)
+MIXER_DEFINE_KERNEL(Mixer_Kernel_PSG_PCM,          0, 1, 0)
+MIXER_DEFINE_KERNEL(Mixer_Kernel_PSG_FM_PCM,       1, 1, 0)
+MIXER_DEFINE_KERNEL(Mixer_Kernel_PSG_CDDA,         0, 0, 1)
+MIXER_DEFINE_KERNEL(Mixer_Kernel_PSG_FM_CDDA,      1, 0, 1)
+MIXER_DEFINE_KERNEL(Mixer_Kernel_PSG_PCM_CDDA,     0, 1, 1)
+MIXER_DEFINE_KERNEL(Mixer_Kernel_PSG_FM_PCM_CDDA,  1, 1, 1)
+
+#undef MIXER_DEFINE_KERNEL
+#undef MIXER_DO_SOURCE
+
+/* Resamples and mixes the first 'total_frames' frames of the current frame's audio. */
+static void Mixer_MixFrames(Mixer_Source* const sources, cc_s16l* const output_buffer, const size_t total_frames)
 {
-	cc_s16l output_buffer[MIXER_MAXIMUM_AUDIO_FRAMES_PER_FRAME * MIXER_CHANNEL_COUNT];
-	cc_s16l *output_buffer_pointer = output_buffer;
+	/* Indexed by which of the FM, PCM, and CDDA have audio this frame. */
+	static void (* const kernels[1 << 3])(const Mixer_Source *sources, cc_s16l *output_buffer_pointer, size_t total_frames, cc_u32f *position, const cc_u32f *ratio) = {
+		Mixer_Kernel_PSG,
+		Mixer_Kernel_PSG_FM,
+		Mixer_Kernel_PSG_PCM,
+		Mixer_Kernel_PSG_FM_PCM,
+		Mixer_Kernel_PSG_CDDA,
+		Mixer_Kernel_PSG_FM_CDDA,
+		Mixer_Kernel_PSG_PCM_CDDA,
+		Mixer_Kernel_PSG_FM_PCM_CDDA
+	};
 
 	size_t available_frames[MIXER_SOURCE_TOTAL];
 	cc_u32f position[MIXER_SOURCE_TOTAL - 1], ratio[MIXER_SOURCE_TOTAL - 1];
 
-	cc_u8f i;
-	cc_u32f frame_index;
+	cc_u8f i, kernel = 0;
 
 	for (i = 0; i < CC_COUNT_OF(available_frames); ++i)
-		available_frames[i] = Mixer_Source_GetTotalAllocatedFrames(&state->sources[i]);
+		available_frames[i] = Mixer_Source_GetTotalAllocatedFrames(&sources[i]);
 
+	/* The number of frames that each source produces varies from frame to frame, so the ratios do too. */
 	for (i = 0; i < CC_COUNT_OF(position); ++i)
 	{
 		position[i] = 0;
 		ratio[i] = MIXER_TO_FIXED_POINT_FROM_INTEGER(available_frames[i]) / available_frames[MIXER_SOURCE_TOTAL - 1];
+
+		/* Sources which received no audio this frame are silent, so do not waste time mixing them. */
+		if (available_frames[i] != 0)
+			kernel |= 1 << i;
 	}
 
-	/* Resample, mix, and output the audio for this frame. */
-	for (frame_index = 0; frame_index < available_frames[MIXER_SOURCE_TOTAL - 1]; ++frame_index)
+	kernels[kernel](sources, output_buffer, total_frames, position, ratio);
+}
+
+/* Time-Stretcher */
+
+static size_t Mixer_TimeStretch_FindBestOffset(const Mixer_TimeStretch* const time_stretch, const cc_s16l* const input, const size_t maximum_offset, const size_t compare_length)
+{
+	/* Find where the new audio most resembles the tail of the last slice, so that the two can be crossfaded without
+	   the waveforms cancelling each other out. The sum of absolute differences is used since it cannot overflow. */
+	size_t best_offset = 0, offset;
+	cc_u32f best_difference = (cc_u32f)-1;
+
+	for (offset = 0; offset <= maximum_offset; offset += MIXER_TIME_STRETCH_SEARCH_STEP)
 	{
-		/* We use a macro instead of a loop so that the division is optimised to a bit-shift. */
-		/* Beware: This code assumes that the sources are stereo! */
-#define MIXER_DO_SOURCE(SOURCE, VOLUME_DIVISOR) \
-		{ \
-			const cc_s16l* const input_frame = Mixer_Source_GetFrame(&state->sources[SOURCE], position[SOURCE]); \
-\
-			for (i = 0; i < CC_COUNT_OF(frame); ++i) \
-				frame[i] += input_frame[i] / (VOLUME_DIVISOR); \
-\
-			position[SOURCE] += ratio[SOURCE]; \
+		cc_u32f difference = 0;
+		size_t i;
+
+		for (i = 0; i < compare_length * MIXER_CHANNEL_COUNT; i += MIXER_TIME_STRETCH_SEARCH_STEP * MIXER_CHANNEL_COUNT)
+		{
+			cc_u8f j;
+
+			for (j = 0; j < MIXER_CHANNEL_COUNT; ++j)
+			{
+				const cc_s32f delta = (cc_s32f)input[offset * MIXER_CHANNEL_COUNT + i + j] - time_stretch->tail[i + j];
+				difference += delta < 0 ? -delta : delta;
+			}
 		}
 
-		/* Mix the FM, PSG, PCM, and CDDA to produce the final audio. */
-		const cc_s16l psg_sample = state->sources[MIXER_SOURCE_PSG].buffer[frame_index * CLOWNMDEMU_PSG_CHANNEL_COUNT] / CLOWNMDEMU_PSG_VOLUME_DIVISOR;
+		if (difference < best_difference)
+		{
+			best_difference = difference;
+			best_offset = offset;
+		}
+	}
+
+	return best_offset;
+}
+
+/* Appends a slice of the frame to the time-stretcher's buffer. */
+static void Mixer_TimeStretch_Frame(Mixer_State* const state, Mixer_Source* const sources, cc_s16l* const output_buffer, const size_t total_frames)
+{
+	Mixer_TimeStretch* const time_stretch = &state->time_stretch;
+	const size_t slice_length = CC_MAX(1, total_frames / state->fast_forward_speed);
+	const size_t overlap = CC_MIN(MIXER_TIME_STRETCH_OVERLAP, slice_length);
+	const size_t search = time_stretch->total_tail_frames == 0 ? 0 : MIXER_TIME_STRETCH_SEARCH;
+	/* The rest of the frame is never mixed, which is where the savings come from. */
+	const size_t total_frames_to_mix = CC_MIN(total_frames, search + slice_length + overlap);
+	const size_t maximum_offset = CC_MIN(search, total_frames_to_mix - CC_MIN(total_frames_to_mix, slice_length + overlap));
+
+	cc_s16l *slice, *output;
+	size_t offset, crossfade_length, tail_length, i;
+
+	Mixer_MixFrames(sources, output_buffer, total_frames_to_mix);
+	PROFILER_COUNT(PROFILER_COUNTER_AUDIO_FRAMES_MIXED, total_frames_to_mix);
+
+	offset = Mixer_TimeStretch_FindBestOffset(time_stretch, output_buffer, maximum_offset, CC_MIN(time_stretch->total_tail_frames, total_frames_to_mix - maximum_offset));
+	slice = &output_buffer[offset * MIXER_CHANNEL_COUNT];
+	output = &time_stretch->buffer[time_stretch->total_frames * MIXER_CHANNEL_COUNT];
+
+	/* Fade from the tail of the last slice into this one. */
+	crossfade_length = CC_MIN(time_stretch->total_tail_frames, slice_length);
+
+	for (i = 0; i < crossfade_length * MIXER_CHANNEL_COUNT; ++i)
+	{
+		const cc_s32f position = (cc_s32f)(i / MIXER_CHANNEL_COUNT);
+		*output++ = (cc_s16l)((time_stretch->tail[i] * ((cc_s32f)crossfade_length - position) + slice[i] * position) / (cc_s32f)crossfade_length);
+	}
+
+	MIXER_MEMMOVE(output, &slice[crossfade_length * MIXER_CHANNEL_COUNT], (slice_length - crossfade_length) * MIXER_CHANNEL_COUNT * sizeof(cc_s16l));
+	time_stretch->total_frames += slice_length;
 
-		cc_s32f frame[MIXER_CHANNEL_COUNT];
+	/* Keep what follows the slice, so that the next slice can be joined onto it seamlessly. */
+	tail_length = CC_MIN(overlap, total_frames_to_mix - offset - slice_length);
+	MIXER_MEMMOVE(time_stretch->tail, &slice[slice_length * MIXER_CHANNEL_COUNT], tail_length * MIXER_CHANNEL_COUNT * sizeof(cc_s16l));
+	time_stretch->total_tail_frames = tail_length;
 
-		for (i = 0; i < CC_COUNT_OF(frame); ++i)
-			frame[i] = psg_sample;
+	MIXER_ASSERT(time_stretch->total_frames <= CC_COUNT_OF(time_stretch->buffer) / MIXER_CHANNEL_COUNT);
+}
+
+static void Mixer_Output(Mixer_State* const state, Mixer_Source* const sources, const Mixer_Callback callback, const void* const user_data)
+{
+	cc_s16l output_buffer[MIXER_MAXIMUM_AUDIO_FRAMES_PER_FRAME * MIXER_CHANNEL_COUNT];
+
+	const size_t total_frames = Mixer_Source_GetTotalAllocatedFrames(&sources[MIXER_SOURCE_PSG]);
+	const cc_s16l *output_frames = output_buffer;
+	size_t total_output_frames = 0;
+
+	/* When muted, there is nothing to do at all. */
+	if (state->fast_forward_mode == MIXER_FAST_FORWARD_MUTE || total_frames == 0)
+		return;
 
-		MIXER_DO_SOURCE(MIXER_SOURCE_FM,   CLOWNMDEMU_FM_VOLUME_DIVISOR  );
-		MIXER_DO_SOURCE(MIXER_SOURCE_PCM,  CLOWNMDEMU_PCM_VOLUME_DIVISOR );
-		MIXER_DO_SOURCE(MIXER_SOURCE_CDDA, CLOWNMDEMU_CDDA_VOLUME_DIVISOR);
+	PROFILER_BEGIN(PROFILER_PROBE_MIXER_END);
 
-		/* Clamp output to S16 sample range. */
-		for (i = 0; i < CC_COUNT_OF(frame); ++i)
-			*output_buffer_pointer++ = CC_CLAMP(-0x7FFF, 0x7FFF, frame[i]);
+	if (state->fast_forward_mode == MIXER_FAST_FORWARD_TIME_STRETCH)
+	{
+		Mixer_TimeStretch* const time_stretch = &state->time_stretch;
+
+		Mixer_TimeStretch_Frame(state, sources, output_buffer, total_frames);
+
+		/* Output once enough slices have been gathered to fill a frame. */
+		if (time_stretch->total_frames >= total_frames)
+		{
+			output_frames = time_stretch->buffer;
+			total_output_frames = time_stretch->total_frames;
+			time_stretch->total_frames = 0;
+		}
+	}
+	else
+	{
+		/* Resample, mix, and output the audio for this frame. */
+		Mixer_MixFrames(sources, output_buffer, total_frames);
+		PROFILER_COUNT(PROFILER_COUNTER_AUDIO_FRAMES_MIXED, total_frames);
+		total_output_frames = total_frames;
 	}
 
+	/* The callback is the frontend's business, so leave it out of the measurement. */
+	PROFILER_END(PROFILER_PROBE_MIXER_END);
+
 	/* Output resampled and mixed samples. */
-	callback((void*)user_data, output_buffer, available_frames[MIXER_SOURCE_TOTAL - 1]);
+	if (total_output_frames != 0)
+		callback((void*)user_data, output_frames, total_output_frames);
+}
+
+static void Mixer_WaitForWorker(Mixer_State* const state)
+{
+	while (MIXER_ATOMIC_LOAD(state->frames_mixed) != state->frames_published)
+		MIXER_YIELD();
+}
+
+void Mixer_End(Mixer_State* const state, const Mixer_Callback callback, const void* const user_data)
+{
+	cc_u8f i;
+
+	if (!state->pipelined)
+	{
+		Mixer_Output(state, state->sources, callback, user_data);
+		return;
+	}
+
+	/* The worker has had a whole frame to mix the previous frame, so this should rarely have to wait. */
+	Mixer_WaitForWorker(state);
+
+	for (i = 0; i < CC_COUNT_OF(state->sources); ++i)
+	{
+		const Mixer_Source source = state->sources[i];
+		state->sources[i] = state->pending_sources[i];
+		state->pending_sources[i] = source;
+	}
+
+	state->pending_callback = callback;
+	state->pending_user_data = user_data;
+
+	MIXER_ATOMIC_STORE(state->frames_published, state->frames_published + 1);
+}
+
+void Mixer_SetFastForward(Mixer_State* const state, const cc_u8f mode, const cc_u8f speed)
+{
+	/* The worker uses these, so do not change them under its feet. */
+	if (state->pipelined)
+		Mixer_WaitForWorker(state);
+
+	state->fast_forward_mode = mode;
+	state->fast_forward_speed = CC_MAX(1, speed);
+
+	/* Do not splice onto audio from before the change. */
+	state->time_stretch.total_frames = 0;
+	state->time_stretch.total_tail_frames = 0;
+}
+
+cc_bool Mixer_EnablePipelining(Mixer_State* const state)
+{
+	cc_u8f i;
+
+	if (state->pipelined)
+		return cc_true;
+
+	for (i = 0; i < CC_COUNT_OF(state->pending_sources); ++i)
+	{
+		const Mixer_Source* const source = &state->sources[i];
+		Mixer_Source* const pending_source = &state->pending_sources[i];
+
+		pending_source->channels = source->channels;
+		pending_source->capacity = source->capacity;
+		pending_source->buffer = (cc_s16l*)MIXER_CALLOC(1, pending_source->capacity * pending_source->channels * sizeof(cc_s16l));
+		pending_source->write_index = 0;
+
+		if (pending_source->buffer == NULL)
+		{
+			while (i-- != 0)
+				Mixer_Source_Deinitialise(&state->pending_sources[i]);
+
+			return cc_false;
+		}
+	}
+
+	state->frames_published = state->frames_mixed = 0;
+	state->pipelined = cc_true;
+
+	return cc_true;
+}
+
+void Mixer_DisablePipelining(Mixer_State* const state)
+{
+	cc_u8f i;
+
+	if (!state->pipelined)
+		return;
+
+	/* The worker thread should have been stopped by now, so finish its work for it. */
+	Mixer_MixPending(state);
+
+	for (i = 0; i < CC_COUNT_OF(state->pending_sources); ++i)
+		Mixer_Source_Deinitialise(&state->pending_sources[i]);
+
+	state->pipelined = cc_false;
+}
+
+cc_bool Mixer_MixPending(Mixer_State* const state)
+{
+	if (MIXER_ATOMIC_LOAD(state->frames_published) == state->frames_mixed)
+		return cc_false;
+
+	Mixer_Output(state, state->pending_sources, state->pending_callback, state->pending_user_data);
+
+	MIXER_ATOMIC_STORE(state->frames_mixed, state->frames_mixed + 1);
+
+	return cc_true;
 }
 
 #endif /* MIXER_IMPLEMENTATION */
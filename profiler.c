@@ -0,0 +1,253 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+/* For 'clock_gettime'. This only works if nothing has included a system header yet, so the build defines it too. */
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/* Each thread has its own buffer, so that they never need to be locked. */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define PROFILER_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define PROFILER_THREAD_LOCAL __thread
+#else
+/* Without thread-local storage, only one thread can be profiled at a time. */
+#define PROFILER_THREAD_LOCAL
+#endif
+
+static PROFILER_THREAD_LOCAL Profiler_Buffer *current_buffer;
+
+static const char* const probe_names[PROFILER_PROBE_TOTAL] = {
+	"Frame",
+	"Mixer_End",
+	"CDReader_SeekToSector",
+	"CDReader_ReadSector",
+	"CDReader_ReadAudio",
+	"CheatManager_ApplyRAMPatches"
+};
+
+static const char* const counter_names[PROFILER_COUNTER_TOTAL] = {
+	"Audio frames mixed",
+	"CD sectors read",
+	"CD audio frames read",
+	"RAM patches applied"
+};
+
+static void Profiler_PushEvent(Profiler_Buffer* const buffer, const cc_u32f time, const unsigned long value, const cc_u8f index, const cc_bool counter)
+{
+	Profiler_Event* const event = &buffer->events[buffer->write_index];
+
+	event->time = time;
+	event->value = value;
+	event->index = index;
+	event->counter = counter;
+
+	if (++buffer->write_index == CC_COUNT_OF(buffer->events))
+	{
+		buffer->write_index = 0;
+		buffer->wrapped = cc_true;
+	}
+}
+
+void Profiler_AttachBuffer(Profiler_Buffer* const buffer, const unsigned long thread_id)
+{
+	buffer->write_index = 0;
+	buffer->wrapped = cc_false;
+	buffer->thread_id = thread_id;
+	memset(&buffer->current_frame, 0, sizeof(buffer->current_frame));
+	memset(&buffer->last_frame, 0, sizeof(buffer->last_frame));
+
+	current_buffer = buffer;
+
+	/* The frame starts now. */
+	buffer->probe_starts[PROFILER_PROBE_FRAME] = Profiler_GetTime();
+}
+
+void Profiler_DetachBuffer(void)
+{
+	current_buffer = NULL;
+}
+
+cc_u32f Profiler_GetTime(void)
+{
+	/* The clock is monotonic, so that it is not thrown off by changes to the system's time.
+	   Only the lower 32 bits are kept, since only the differences between times matter. */
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	/* Split the conversion to avoid both overflow and precision loss. */
+	return (cc_u32f)(counter.QuadPart / frequency.QuadPart * 1000000 + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart) & 0xFFFFFFFF;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec timespec;
+
+	clock_gettime(CLOCK_MONOTONIC, &timespec);
+	return ((cc_u32f)timespec.tv_sec * 1000000 + (cc_u32f)timespec.tv_nsec / 1000) & 0xFFFFFFFF;
+#else
+	/* Without POSIX, fall back on processor time, which is coarser, but is at least never adjusted. */
+	const clock_t ticks = clock();
+
+	return ((cc_u32f)(ticks / CLOCKS_PER_SEC) * 1000000 + (cc_u32f)(ticks % CLOCKS_PER_SEC) * 1000000 / CLOCKS_PER_SEC) & 0xFFFFFFFF;
+#endif
+}
+
+cc_u32f Profiler_GetMicrosecondsSince(const cc_u32f start)
+{
+	return (Profiler_GetTime() - start) & 0xFFFFFFFF;
+}
+
+/* Times wrap around, so they are compared by their signed difference. */
+static long Profiler_GetTimeDifference(const cc_u32f time, const cc_u32f origin)
+{
+	const cc_u32f difference = (time - origin) & 0xFFFFFFFF;
+
+	if ((difference & 0x80000000) == 0)
+		return (long)difference;
+
+	return (long)(difference - 0x80000000) - 0x7FFFFFFF - 1;
+}
+
+void Profiler_Begin(const cc_u8f probe)
+{
+	Profiler_Buffer* const buffer = current_buffer;
+
+	if (buffer == NULL)
+		return;
+
+	buffer->probe_starts[probe] = Profiler_GetTime();
+}
+
+void Profiler_End(const cc_u8f probe)
+{
+	Profiler_Buffer* const buffer = current_buffer;
+	unsigned long duration;
+
+	if (buffer == NULL)
+		return;
+
+	duration = Profiler_GetMicrosecondsSince(buffer->probe_starts[probe]);
+
+	Profiler_PushEvent(buffer, buffer->probe_starts[probe], duration, probe, cc_false);
+
+	buffer->current_frame.microseconds[probe] += duration;
+	++buffer->current_frame.calls[probe];
+}
+
+void Profiler_Count(const cc_u8f counter, const unsigned long amount)
+{
+	Profiler_Buffer* const buffer = current_buffer;
+
+	if (buffer == NULL)
+		return;
+
+	buffer->current_frame.counters[counter] += amount;
+}
+
+void Profiler_EndFrame(void)
+{
+	Profiler_Buffer* const buffer = current_buffer;
+	cc_u32f frame_end;
+	cc_u8f i;
+
+	if (buffer == NULL)
+		return;
+
+	Profiler_End(PROFILER_PROBE_FRAME);
+
+	frame_end = (buffer->probe_starts[PROFILER_PROBE_FRAME] + buffer->current_frame.microseconds[PROFILER_PROBE_FRAME]) & 0xFFFFFFFF;
+
+	for (i = 0; i < PROFILER_COUNTER_TOTAL; ++i)
+		Profiler_PushEvent(buffer, frame_end, buffer->current_frame.counters[i], i, cc_true);
+
+	buffer->last_frame = buffer->current_frame;
+	memset(&buffer->current_frame, 0, sizeof(buffer->current_frame));
+
+	Profiler_Begin(PROFILER_PROBE_FRAME);
+}
+
+const Profiler_FrameStatistics* Profiler_GetFrameStatistics(const Profiler_Buffer* const buffer)
+{
+	return &buffer->last_frame;
+}
+
+const char* Profiler_GetProbeName(const cc_u8f probe)
+{
+	return probe_names[probe];
+}
+
+const char* Profiler_GetCounterName(const cc_u8f counter)
+{
+	return counter_names[counter];
+}
+
+static const Profiler_Event* Profiler_GetEvent(const Profiler_Buffer* const buffer, const size_t index)
+{
+	const size_t first_event = buffer->wrapped ? buffer->write_index : 0;
+
+	return &buffer->events[(first_event + index) % CC_COUNT_OF(buffer->events)];
+}
+
+static size_t Profiler_GetTotalEvents(const Profiler_Buffer* const buffer)
+{
+	return buffer->wrapped ? CC_COUNT_OF(buffer->events) : buffer->write_index;
+}
+
+void Profiler_ExportChromeTrace(const Profiler_Buffer* const* const buffers, const size_t total_buffers, const Profiler_WriteCallback callback, const void* const user_data)
+{
+	/* Large enough for the longest event. */
+	char string[0x100];
+	cc_bool first = cc_true;
+	cc_bool have_origin = cc_false;
+	cc_u32f origin = 0;
+	size_t i, j;
+
+	/* Timestamps are made relative to the earliest event, so that wrapping around does not put events out of order. */
+	for (i = 0; i < total_buffers; ++i)
+	{
+		for (j = 0; j < Profiler_GetTotalEvents(buffers[i]); ++j)
+		{
+			const Profiler_Event* const event = Profiler_GetEvent(buffers[i], j);
+
+			if (!have_origin || Profiler_GetTimeDifference(event->time, origin) < 0)
+			{
+				origin = event->time;
+				have_origin = cc_true;
+			}
+		}
+	}
+
+	callback((void*)user_data, "{\"traceEvents\":[\n");
+
+	for (i = 0; i < total_buffers; ++i)
+	{
+		const Profiler_Buffer* const buffer = buffers[i];
+
+		for (j = 0; j < Profiler_GetTotalEvents(buffer); ++j)
+		{
+			const Profiler_Event* const event = Profiler_GetEvent(buffer, j);
+			const long time = Profiler_GetTimeDifference(event->time, origin);
+
+			if (event->counter)
+				sprintf(string, "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%ld,\"pid\":1,\"tid\":%lu,\"args\":{\"value\":%lu}}", first ? "" : ",\n", counter_names[event->index], time, buffer->thread_id, event->value);
+			else
+				sprintf(string, "%s{\"name\":\"%s\",\"cat\":\"clownmdemu-frontend-common\",\"ph\":\"X\",\"ts\":%ld,\"dur\":%lu,\"pid\":1,\"tid\":%lu}", first ? "" : ",\n", probe_names[event->index], time, event->value, buffer->thread_id);
+
+			callback((void*)user_data, string);
+			first = cc_false;
+		}
+	}
+
+	callback((void*)user_data, "\n]}\n");
+}
@@ -0,0 +1,109 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_PROFILER_H
+#define CLOWNMDEMU_FRONTEND_COMMON_PROFILER_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+
+/* Times the hot paths of the library and counts the work that they do.
+
+   Each thread which should be profiled attaches its own buffer, which only it
+   writes to, so no locking is needed. Threads without a buffer are ignored.
+   Buffers can be exported to Chrome's trace-event format (viewable in
+   'chrome://tracing' or Perfetto) once their threads have stopped recording,
+   and each one keeps a summary of the last frame for debug overlays.
+
+   The instrumentation is only compiled in when CLOWNMDEMU_FRONTEND_COMMON_PROFILER
+   is defined; otherwise, the macros below do nothing. The clock is always
+   available, for anything else which needs to time itself. Its times are in
+   microseconds and wrap around every 71 minutes or so, so only the difference
+   between two of them means anything. */
+
+#define PROFILER_MAXIMUM_EVENTS 0x2000
+
+#ifdef CLOWNMDEMU_FRONTEND_COMMON_PROFILER
+#define PROFILER_BEGIN(PROBE) Profiler_Begin(PROBE)
+#define PROFILER_END(PROBE) Profiler_End(PROBE)
+#define PROFILER_COUNT(COUNTER, AMOUNT) Profiler_Count(COUNTER, AMOUNT)
+#else
+#define PROFILER_BEGIN(PROBE) ((void)0)
+#define PROFILER_END(PROBE) ((void)0)
+#define PROFILER_COUNT(COUNTER, AMOUNT) ((void)0)
+#endif
+
+enum
+{
+	PROFILER_PROBE_FRAME,
+	PROFILER_PROBE_MIXER_END,
+	PROFILER_PROBE_CD_SEEK_TO_SECTOR,
+	PROFILER_PROBE_CD_READ_SECTOR,
+	PROFILER_PROBE_CD_READ_AUDIO,
+	PROFILER_PROBE_CHEAT_APPLY_RAM_PATCHES,
+
+	/* Ignore this; this is just the total number of enums. */
+	PROFILER_PROBE_TOTAL
+};
+
+enum
+{
+	PROFILER_COUNTER_AUDIO_FRAMES_MIXED,
+	PROFILER_COUNTER_CD_SECTORS_READ,
+	PROFILER_COUNTER_CD_AUDIO_FRAMES_READ,
+	PROFILER_COUNTER_RAM_PATCHES_APPLIED,
+
+	/* Ignore this; this is just the total number of enums. */
+	PROFILER_COUNTER_TOTAL
+};
+
+typedef struct Profiler_FrameStatistics
+{
+	unsigned long microseconds[PROFILER_PROBE_TOTAL];
+	unsigned long calls[PROFILER_PROBE_TOTAL];
+	unsigned long counters[PROFILER_COUNTER_TOTAL];
+} Profiler_FrameStatistics;
+
+typedef struct Profiler_Event
+{
+	/* For counters, 'value' is the total for the frame that ends at 'time'. For probes, it is the duration. */
+	cc_u32l time;
+	unsigned long value;
+	cc_u8l index;
+	cc_bool counter;
+} Profiler_Event;
+
+typedef struct Profiler_Buffer
+{
+	/* Ring buffer; when full, the oldest events are overwritten. */
+	Profiler_Event events[PROFILER_MAXIMUM_EVENTS];
+	size_t write_index;
+	cc_bool wrapped;
+
+	unsigned long thread_id;
+	cc_u32l probe_starts[PROFILER_PROBE_TOTAL];
+	Profiler_FrameStatistics current_frame, last_frame;
+} Profiler_Buffer;
+
+typedef void (*Profiler_WriteCallback)(void *user_data, const char *string);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void Profiler_AttachBuffer(Profiler_Buffer *buffer, unsigned long thread_id);
+void Profiler_DetachBuffer(void);
+cc_u32f Profiler_GetTime(void);
+cc_u32f Profiler_GetMicrosecondsSince(cc_u32f start);
+void Profiler_Begin(cc_u8f probe);
+void Profiler_End(cc_u8f probe);
+void Profiler_Count(cc_u8f counter, unsigned long amount);
+void Profiler_EndFrame(void);
+const Profiler_FrameStatistics* Profiler_GetFrameStatistics(const Profiler_Buffer *buffer);
+const char* Profiler_GetProbeName(cc_u8f probe);
+const char* Profiler_GetCounterName(cc_u8f counter);
+void Profiler_ExportChromeTrace(const Profiler_Buffer* const *buffers, size_t total_buffers, Profiler_WriteCallback callback, const void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_PROFILER_H */
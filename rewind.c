@@ -0,0 +1,314 @@
+#include "rewind.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta.h"
+#include "profiler.h"
+
+/* Each frame is made of these three parts, laid out back-to-back in the reference buffer. */
+#define REWIND_EMULATOR_SIZE sizeof(((const ClownMDEmu*)NULL)->state)
+#define REWIND_CD_READER_OFFSET REWIND_EMULATOR_SIZE
+#define REWIND_CHEATS_OFFSET (REWIND_CD_READER_OFFSET + sizeof(CDReader_StateBackup))
+#define REWIND_FRAME_SIZE (REWIND_CHEATS_OFFSET + sizeof(CheatManager_Snapshot))
+
+#define REWIND_MAXIMUM_ENTRY_SIZE (DELTA_MAXIMUM_ENCODED_SIZE(REWIND_EMULATOR_SIZE) + DELTA_MAXIMUM_ENCODED_SIZE(sizeof(CDReader_StateBackup)) + DELTA_MAXIMUM_ENCODED_SIZE(sizeof(CheatManager_Snapshot)))
+
+typedef struct Rewind_Segment
+{
+	const void *data;
+	size_t offset, size;
+} Rewind_Segment;
+
+static Rewind_Entry* Rewind_GetEntry(const Rewind_State* const state, const size_t index)
+{
+	return &state->entries[(state->first_entry + index) % state->maximum_entries];
+}
+
+static cc_bool Rewind_IsKeyframe(const Rewind_State* const state, const size_t index)
+{
+	return Rewind_GetEntry(state, index)->keyframe_serial == state->first_serial + index;
+}
+
+static void Rewind_DiscardOldest(Rewind_State* const state)
+{
+	/* Frames cannot outlive their keyframe, so discard them too. */
+	do
+	{
+		state->statistics.memory_used -= Rewind_GetEntry(state, 0)->size;
+
+		if (Rewind_IsKeyframe(state, 0))
+			--state->statistics.total_keyframes;
+
+		/* Do not encode any more frames relative to a keyframe that is gone. */
+		if (state->first_serial == state->reference_serial)
+			state->reference_valid = cc_false;
+
+		state->first_entry = (state->first_entry + 1) % state->maximum_entries;
+		++state->first_serial;
+		--state->total_entries;
+	} while (state->total_entries != 0 && !Rewind_IsKeyframe(state, 0));
+}
+
+static cc_bool Rewind_IsArenaFree(const Rewind_State* const state, const size_t position)
+{
+	size_t oldest, newest_end;
+
+	/* There is no oldest entry to read otherwise. */
+	if (state->total_entries == 0)
+		return cc_true;
+
+	oldest = Rewind_GetEntry(state, 0)->offset;
+	newest_end = state->arena_position;
+
+	/* The used part of the arena spans from the oldest entry to the end of the newest, and may wrap around. */
+	if (oldest < newest_end)
+		return position >= newest_end || position + REWIND_MAXIMUM_ENTRY_SIZE <= oldest;
+	else
+		return position >= newest_end && position + REWIND_MAXIMUM_ENTRY_SIZE <= oldest;
+}
+
+static size_t Rewind_MakeRoom(Rewind_State* const state)
+{
+	for (;;)
+	{
+		/* Entries must be contiguous, so wrap around early if there is not enough room for the largest possible entry. */
+		const size_t position = state->arena_size - state->arena_position >= REWIND_MAXIMUM_ENTRY_SIZE ? state->arena_position : 0;
+
+		if (state->total_entries != state->maximum_entries && Rewind_IsArenaFree(state, position))
+			return position;
+
+		Rewind_DiscardOldest(state);
+	}
+}
+
+static void Rewind_GetSegments(Rewind_Segment* const segments, const void* const emulator, const CDReader_StateBackup* const cd_reader, const CheatManager_Snapshot* const cheats)
+{
+	segments[0].data = emulator;
+	segments[0].offset = 0;
+	segments[0].size = REWIND_EMULATOR_SIZE;
+	segments[1].data = cd_reader;
+	segments[1].offset = REWIND_CD_READER_OFFSET;
+	segments[1].size = sizeof(*cd_reader);
+	segments[2].data = cheats;
+	segments[2].offset = REWIND_CHEATS_OFFSET;
+	segments[2].size = sizeof(*cheats);
+}
+
+static cc_bool Rewind_DecodeEntry(const Rewind_State* const state, const Rewind_Entry* const entry)
+{
+	Rewind_Segment segments[3];
+	const unsigned char *input = &state->arena[entry->offset];
+	const unsigned char* const input_end = input + entry->size;
+	cc_u8f i;
+
+	Rewind_GetSegments(segments, NULL, NULL, NULL);
+
+	for (i = 0; i < CC_COUNT_OF(segments); ++i)
+	{
+		const size_t bytes_read = Delta_Decode(&state->reference[segments[i].offset], segments[i].size, input, input_end - input);
+
+		if (bytes_read == 0)
+			return cc_false;
+
+		input += bytes_read;
+	}
+
+	return cc_true;
+}
+
+cc_bool Rewind_Initialise(Rewind_State* const state, const size_t memory_budget, const size_t maximum_frames, const unsigned int keyframe_interval)
+{
+	if (memory_budget < REWIND_MAXIMUM_ENTRY_SIZE || maximum_frames == 0 || keyframe_interval == 0)
+		return cc_false;
+
+	state->arena = (unsigned char*)malloc(memory_budget);
+	state->entries = (Rewind_Entry*)malloc(maximum_frames * sizeof(*state->entries));
+	state->reference = (unsigned char*)malloc(REWIND_FRAME_SIZE);
+
+	if (state->arena == NULL || state->entries == NULL || state->reference == NULL)
+	{
+		Rewind_Deinitialise(state);
+		return cc_false;
+	}
+
+	state->arena_size = memory_budget;
+	state->maximum_entries = maximum_frames;
+	state->keyframe_interval = keyframe_interval;
+
+	Rewind_Clear(state);
+
+	return cc_true;
+}
+
+void Rewind_Deinitialise(Rewind_State* const state)
+{
+	free(state->arena);
+	free(state->entries);
+	free(state->reference);
+}
+
+void Rewind_Clear(Rewind_State* const state)
+{
+	state->arena_position = 0;
+	state->first_entry = 0;
+	state->total_entries = 0;
+	state->first_serial = 0;
+	state->reference_serial = 0;
+	state->reference_valid = cc_false;
+
+	memset(&state->statistics, 0, sizeof(state->statistics));
+	state->statistics.memory_capacity = state->arena_size + state->maximum_entries * sizeof(*state->entries) + REWIND_FRAME_SIZE;
+}
+
+cc_bool Rewind_Capture(Rewind_State* const state, const ClownMDEmu* const clownmdemu, const CDReader_State* const cd_reader, const CheatManager* const cheat_manager)
+{
+	const cc_u32f start = Profiler_GetTime();
+
+	CDReader_StateBackup cd_reader_backup;
+	CheatManager_Snapshot cheats;
+	Rewind_Segment segments[3];
+	Rewind_Entry *entry;
+	size_t position;
+	unsigned char *output;
+	unsigned long serial;
+	cc_bool keyframe;
+	cc_u8f i;
+
+	/* Clear these so that padding and unused cheats do not turn into noise in the deltas. */
+	memset(&cd_reader_backup, 0, sizeof(cd_reader_backup));
+	memset(&cheats, 0, sizeof(cheats));
+
+	if (cd_reader != NULL)
+		CDReader_SaveState(cd_reader, &cd_reader_backup);
+
+	if (cheat_manager != NULL)
+		CheatManager_SaveSnapshot(cheat_manager, &cheats);
+
+	Rewind_GetSegments(segments, &clownmdemu->state, &cd_reader_backup, &cheats);
+
+	/* This may discard old entries, so it must be done before anything else. */
+	position = Rewind_MakeRoom(state);
+
+	entry = Rewind_GetEntry(state, state->total_entries);
+	entry->offset = position;
+	serial = state->first_serial + state->total_entries;
+
+	keyframe = !state->reference_valid || serial - state->reference_serial >= state->keyframe_interval;
+
+	output = &state->arena[entry->offset];
+
+	for (i = 0; i < CC_COUNT_OF(segments); ++i)
+	{
+		if (keyframe)
+		{
+			output += Delta_Encode(output, segments[i].data, NULL, segments[i].size);
+			memcpy(&state->reference[segments[i].offset], segments[i].data, segments[i].size);
+		}
+		else
+		{
+			output += Delta_Encode(output, segments[i].data, &state->reference[segments[i].offset], segments[i].size);
+		}
+	}
+
+	if (keyframe)
+	{
+		state->reference_serial = serial;
+		state->reference_valid = cc_true;
+		++state->statistics.total_keyframes;
+	}
+
+	entry->size = output - &state->arena[entry->offset];
+	entry->keyframe_serial = state->reference_serial;
+
+	state->arena_position = entry->offset + entry->size;
+	++state->total_entries;
+
+	state->statistics.total_frames = state->total_entries;
+	state->statistics.memory_used += entry->size;
+	state->statistics.uncompressed_size = state->total_entries * REWIND_FRAME_SIZE;
+	state->statistics.last_capture_microseconds = Profiler_GetMicrosecondsSince(start);
+
+	return cc_true;
+}
+
+cc_bool Rewind_Step(Rewind_State* const state, ClownMDEmu* const clownmdemu, CDReader_State* const cd_reader, CheatManager* const cheat_manager, cc_u16l* const rom, const size_t rom_length)
+{
+	const cc_u32f start = Profiler_GetTime();
+
+	const Rewind_Entry *entry;
+	unsigned long serial;
+	cc_bool keyframe;
+	CDReader_StateBackup cd_reader_backup;
+	CheatManager_Snapshot cheats;
+
+	if (state->total_entries == 0)
+		return cc_false;
+
+	entry = Rewind_GetEntry(state, state->total_entries - 1);
+	serial = state->first_serial + state->total_entries - 1;
+	keyframe = entry->keyframe_serial == serial;
+
+	/* Make sure that the reference holds this frame's keyframe. When stepping
+	   backwards through consecutive frames, it usually already will. */
+	if (!state->reference_valid || state->reference_serial != entry->keyframe_serial)
+	{
+		memset(state->reference, 0, REWIND_FRAME_SIZE);
+
+		if (!Rewind_DecodeEntry(state, Rewind_GetEntry(state, entry->keyframe_serial - state->first_serial)))
+			return cc_false;
+
+		state->reference_serial = entry->keyframe_serial;
+		state->reference_valid = cc_true;
+	}
+
+	/* Temporarily turn the keyframe into this frame. */
+	if (!keyframe && !Rewind_DecodeEntry(state, entry))
+		return cc_false;
+
+	memcpy(&clownmdemu->state, &state->reference[0], REWIND_EMULATOR_SIZE);
+
+	if (cd_reader != NULL)
+	{
+		memcpy(&cd_reader_backup, &state->reference[REWIND_CD_READER_OFFSET], sizeof(cd_reader_backup));
+		CDReader_LoadState(cd_reader, &cd_reader_backup);
+	}
+
+	if (cheat_manager != NULL)
+	{
+		memcpy(&cheats, &state->reference[REWIND_CHEATS_OFFSET], sizeof(cheats));
+		CheatManager_LoadSnapshot(cheat_manager, rom, rom_length, &cheats);
+	}
+
+	/* Undo the above. This cannot fail, since it worked the first time. */
+	if (!keyframe)
+		Rewind_DecodeEntry(state, entry);
+
+	/* Pop the frame. */
+	state->arena_position = entry->offset;
+	--state->total_entries;
+
+	if (keyframe)
+	{
+		--state->statistics.total_keyframes;
+		state->reference_valid = cc_false;
+	}
+
+	state->statistics.total_frames = state->total_entries;
+	state->statistics.memory_used -= entry->size;
+	state->statistics.uncompressed_size = state->total_entries * REWIND_FRAME_SIZE;
+	state->statistics.last_restore_microseconds = Profiler_GetMicrosecondsSince(start);
+
+	return cc_true;
+}
+
+cc_bool Rewind_Exhausted(const Rewind_State* const state)
+{
+	return state->total_entries == 0;
+}
+
+const Rewind_Statistics* Rewind_GetStatistics(const Rewind_State* const state)
+{
+	return &state->statistics;
+}
@@ -0,0 +1,152 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_REWIND_H
+#define CLOWNMDEMU_FRONTEND_COMMON_REWIND_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+#include "core/source/clownmdemu.h"
+
+#include "cd-reader.h"
+#include "cheat.h"
+
+/* A rewind buffer which stores a history of frames in a fixed amount of memory.
+
+   Every so often, a frame is stored in full as a 'keyframe'. The frames between
+   keyframes only store how they differ from the keyframe before them, so any
+   frame can be restored by decoding at most two entries. When the memory runs
+   out, the oldest keyframe is discarded along with the frames that rely on it.
+
+   The CD reader and cheat manager are optional, and may be NULL. */
+
+typedef struct Rewind_Entry
+{
+	size_t offset, size;
+	/* Serial numbers increase by one with every frame that is captured. */
+	unsigned long keyframe_serial;
+} Rewind_Entry;
+
+typedef struct Rewind_Statistics
+{
+	size_t total_frames;
+	size_t total_keyframes;
+	size_t memory_used;
+	size_t memory_capacity;
+	/* How much memory the frames would take without compression. */
+	size_t uncompressed_size;
+	unsigned long last_capture_microseconds;
+	unsigned long last_restore_microseconds;
+} Rewind_Statistics;
+
+typedef struct Rewind_State
+{
+	/* Ring buffer of encoded frames. */
+	unsigned char *arena;
+	size_t arena_size, arena_position;
+
+	/* Ring buffer of entries, one per frame. */
+	Rewind_Entry *entries;
+	size_t maximum_entries, first_entry, total_entries;
+	unsigned long first_serial;
+
+	/* The unencoded copy of a keyframe that the other frames are encoded relative to. */
+	unsigned char *reference;
+	unsigned long reference_serial;
+	cc_bool reference_valid;
+
+	unsigned int keyframe_interval;
+	Rewind_Statistics statistics;
+} Rewind_State;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cc_bool Rewind_Initialise(Rewind_State *state, size_t memory_budget, size_t maximum_frames, unsigned int keyframe_interval);
+void Rewind_Deinitialise(Rewind_State *state);
+void Rewind_Clear(Rewind_State *state);
+cc_bool Rewind_Capture(Rewind_State *state, const ClownMDEmu *clownmdemu, const CDReader_State *cd_reader, const CheatManager *cheat_manager);
+cc_bool Rewind_Step(Rewind_State *state, ClownMDEmu *clownmdemu, CDReader_State *cd_reader, CheatManager *cheat_manager, cc_u16l *rom, size_t rom_length);
+cc_bool Rewind_Exhausted(const Rewind_State *state);
+const Rewind_Statistics* Rewind_GetStatistics(const Rewind_State *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+class Rewind
+{
+protected:
+	Rewind_State state;
+	bool initialised;
+
+public:
+	Rewind(const std::size_t memory_budget, const std::size_t maximum_frames, const unsigned int keyframe_interval)
+	{
+		initialised = Rewind_Initialise(&state, memory_budget, maximum_frames, keyframe_interval);
+	}
+	Rewind(const Rewind &other) = delete;
+	Rewind(Rewind &&other)
+		: state(other.state)
+		, initialised(other.initialised)
+	{
+		other.initialised = false;
+	}
+	Rewind& operator=(const Rewind &other) = delete;
+	Rewind& operator=(Rewind &&other)
+	{
+		std::swap(state, other.state);
+		std::swap(initialised, other.initialised);
+		return *this;
+	}
+
+	~Rewind()
+	{
+		if (initialised)
+			Rewind_Deinitialise(&state);
+	}
+
+	bool Initialised() const
+	{
+		return initialised;
+	}
+
+	void Clear()
+	{
+		assert(Initialised());
+		Rewind_Clear(&state);
+	}
+
+	bool Capture(const ClownMDEmu* const clownmdemu, const CDReader_State* const cd_reader, const CheatManager* const cheat_manager)
+	{
+		assert(Initialised());
+		return Rewind_Capture(&state, clownmdemu, cd_reader, cheat_manager);
+	}
+
+	bool Step(ClownMDEmu* const clownmdemu, CDReader_State* const cd_reader, CheatManager* const cheat_manager, cc_u16l* const rom, const std::size_t rom_length)
+	{
+		assert(Initialised());
+		return Rewind_Step(&state, clownmdemu, cd_reader, cheat_manager, rom, rom_length);
+	}
+
+	bool Exhausted() const
+	{
+		assert(Initialised());
+		return Rewind_Exhausted(&state);
+	}
+
+	const Rewind_Statistics& GetStatistics() const
+	{
+		assert(Initialised());
+		return *Rewind_GetStatistics(&state);
+	}
+};
+
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_REWIND_H */
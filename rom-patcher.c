@@ -0,0 +1,566 @@
+#include "rom-patcher.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc32.h"
+
+/* UPS and BPS patches end with three CRC-32s: the ROM's, the patched ROM's, and the patch's. */
+#define ROMPATCHER_FOOTER_SIZE 12
+
+typedef struct ROMPatcher_Reader
+{
+	void *stream;
+	const ROMPatcher_Callbacks *callbacks;
+	/* Of the next byte to be read. */
+	size_t position;
+	/* Bytes before this position are hashed as they are read. */
+	size_t hash_limit;
+	cc_u32f hash;
+	cc_bool failed;
+	size_t buffer_index, buffer_size;
+	unsigned char buffer[0x1000];
+} ROMPatcher_Reader;
+
+typedef struct ROMPatcher_Context
+{
+	/* The patched ROM is written to 'rom', which starts out as a copy of 'source'. For IPS, they are the same buffer. */
+	cc_u16l *rom;
+	const cc_u16l *source;
+	size_t capacity;
+	size_t source_size, target_size;
+	/* When applying, all of this has been validated by an earlier scan. */
+	cc_bool apply;
+	unsigned char footer[ROMPATCHER_FOOTER_SIZE];
+} ROMPatcher_Context;
+
+/* ROM Access */
+
+static unsigned char ROMPatcher_GetByte(const cc_u16l* const rom, const size_t index)
+{
+	/* The ROM is big-endian. */
+	return (rom[index / 2] >> (index % 2 != 0 ? 0 : 8)) & 0xFF;
+}
+
+static void ROMPatcher_SetByte(cc_u16l* const rom, const size_t index, const unsigned char value)
+{
+	const cc_u8f shift = index % 2 != 0 ? 0 : 8;
+
+	rom[index / 2] = (rom[index / 2] & (0xFF00 >> shift)) | (cc_u16l)value << shift;
+}
+
+static cc_u32f ROMPatcher_ReadU32LE(const unsigned char* const bytes)
+{
+	return (cc_u32f)bytes[0] | (cc_u32f)bytes[1] << 8 | (cc_u32f)bytes[2] << 16 | (cc_u32f)bytes[3] << 24;
+}
+
+/* Patch Streaming */
+
+static cc_bool ROMPatcher_Reader_Begin(ROMPatcher_Reader* const reader, void* const stream, const ROMPatcher_Callbacks* const callbacks, const size_t hash_limit)
+{
+	reader->stream = stream;
+	reader->callbacks = callbacks;
+	reader->position = 0;
+	reader->hash_limit = hash_limit;
+	reader->hash = 0;
+	reader->failed = cc_false;
+	reader->buffer_index = reader->buffer_size = 0;
+
+	return callbacks->seek(stream, 0);
+}
+
+static cc_bool ROMPatcher_Reader_Refill(ROMPatcher_Reader* const reader)
+{
+	reader->buffer_index = 0;
+	reader->buffer_size = reader->callbacks->read(reader->stream, reader->buffer, sizeof(reader->buffer));
+
+	if (reader->buffer_size == 0)
+	{
+		reader->failed = cc_true;
+		return cc_false;
+	}
+
+	/* Hash whole buffers at once, since that is much faster than hashing byte-by-byte. */
+	if (reader->position < reader->hash_limit)
+		reader->hash = CRC32_Update(reader->hash, reader->buffer, CC_MIN(reader->buffer_size, reader->hash_limit - reader->position));
+
+	return cc_true;
+}
+
+static unsigned char ROMPatcher_Reader_ReadByte(ROMPatcher_Reader* const reader)
+{
+	if (reader->buffer_index == reader->buffer_size && !ROMPatcher_Reader_Refill(reader))
+		return 0;
+
+	++reader->position;
+	return reader->buffer[reader->buffer_index++];
+}
+
+static cc_bool ROMPatcher_Reader_Read(ROMPatcher_Reader* const reader, unsigned char* const buffer, const size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; ++i)
+		buffer[i] = ROMPatcher_Reader_ReadByte(reader);
+
+	return !reader->failed;
+}
+
+static cc_bool ROMPatcher_Reader_ReadBigEndian(ROMPatcher_Reader* const reader, const cc_u8f total_bytes, size_t* const value)
+{
+	cc_u8f i;
+
+	*value = 0;
+
+	for (i = 0; i < total_bytes; ++i)
+		*value = *value << 8 | ROMPatcher_Reader_ReadByte(reader);
+
+	return !reader->failed;
+}
+
+/* The variable-length integer format used by UPS and BPS. */
+static cc_bool ROMPatcher_Reader_ReadNumber(ROMPatcher_Reader* const reader, size_t* const value)
+{
+	size_t shift = 1;
+
+	*value = 0;
+
+	for (;;)
+	{
+		const unsigned char byte = ROMPatcher_Reader_ReadByte(reader);
+
+		if (reader->failed)
+			return cc_false;
+
+		*value += (byte & 0x7F) * shift;
+
+		if ((byte & 0x80) != 0)
+			return cc_true;
+
+		/* Nothing needs numbers this large, so this is probably a corrupt patch. */
+		if (shift >= (size_t)1 << 21)
+			return cc_false;
+
+		shift <<= 7;
+		*value += shift;
+	}
+}
+
+static cc_bool ROMPatcher_Reader_ReadFooter(ROMPatcher_Reader* const reader, ROMPatcher_Context* const context, const size_t patch_size)
+{
+	if (reader->position != patch_size - ROMPATCHER_FOOTER_SIZE)
+		return cc_false;
+
+	return ROMPatcher_Reader_Read(reader, context->footer, sizeof(context->footer));
+}
+
+/* Formats */
+
+static cc_bool ROMPatcher_ProcessIPS(ROMPatcher_Reader* const reader, ROMPatcher_Context* const context, const size_t patch_size)
+{
+	size_t end_of_writes = context->source_size;
+
+	if (!context->apply)
+		context->target_size = context->source_size;
+
+	for (;;)
+	{
+		size_t offset, length, i;
+
+		if (!ROMPatcher_Reader_ReadBigEndian(reader, 3, &offset))
+			return cc_false;
+
+		/* 'EOF' */
+		if (offset == 0x454F46)
+			break;
+
+		if (!ROMPatcher_Reader_ReadBigEndian(reader, 2, &length))
+			return cc_false;
+
+		if (length != 0)
+		{
+			if (offset + length > context->capacity)
+				return cc_false;
+
+			for (i = 0; i < length; ++i)
+			{
+				const unsigned char byte = ROMPatcher_Reader_ReadByte(reader);
+
+				if (context->apply)
+					ROMPatcher_SetByte(context->rom, offset + i, byte);
+			}
+		}
+		else
+		{
+			/* Run-length encoded record. */
+			unsigned char byte;
+
+			if (!ROMPatcher_Reader_ReadBigEndian(reader, 2, &length))
+				return cc_false;
+
+			byte = ROMPatcher_Reader_ReadByte(reader);
+
+			if (offset + length > context->capacity)
+				return cc_false;
+
+			if (context->apply)
+				for (i = 0; i < length; ++i)
+					ROMPatcher_SetByte(context->rom, offset + i, byte);
+		}
+
+		if (reader->failed)
+			return cc_false;
+
+		end_of_writes = CC_MAX(end_of_writes, offset + length);
+	}
+
+	if (!context->apply)
+	{
+		context->target_size = end_of_writes;
+
+		/* An optional extension which truncates the ROM. */
+		if (reader->position + 3 <= patch_size && !ROMPatcher_Reader_ReadBigEndian(reader, 3, &context->target_size))
+			return cc_false;
+	}
+
+	return cc_true;
+}
+
+static cc_bool ROMPatcher_ProcessUPS(ROMPatcher_Reader* const reader, ROMPatcher_Context* const context, const size_t patch_size)
+{
+	size_t input_size, output_size, offset = 0;
+
+	if (!ROMPatcher_Reader_ReadNumber(reader, &input_size) || !ROMPatcher_Reader_ReadNumber(reader, &output_size))
+		return cc_false;
+
+	if (input_size != context->source_size || output_size > context->capacity)
+		return cc_false;
+
+	context->target_size = output_size;
+
+	while (reader->position < patch_size - ROMPATCHER_FOOTER_SIZE)
+	{
+		size_t skip;
+
+		if (!ROMPatcher_Reader_ReadNumber(reader, &skip))
+			return cc_false;
+
+		offset += skip;
+
+		/* XOR bytes until a 0 is encountered. */
+		for (;;)
+		{
+			const unsigned char byte = ROMPatcher_Reader_ReadByte(reader);
+
+			if (reader->failed)
+				return cc_false;
+
+			if (byte == 0)
+				break;
+
+			if (offset >= output_size)
+				return cc_false;
+
+			if (context->apply)
+				ROMPatcher_SetByte(context->rom, offset, ROMPatcher_GetByte(context->rom, offset) ^ byte);
+
+			++offset;
+		}
+
+		++offset;
+	}
+
+	return ROMPatcher_Reader_ReadFooter(reader, context, patch_size);
+}
+
+static cc_bool ROMPatcher_ProcessBPS(ROMPatcher_Reader* const reader, ROMPatcher_Context* const context, const size_t patch_size)
+{
+	enum
+	{
+		SOURCE_READ,
+		TARGET_READ,
+		SOURCE_COPY,
+		TARGET_COPY
+	};
+
+	size_t source_size, metadata_size, i;
+	size_t output_offset = 0, source_offset = 0, target_offset = 0;
+
+	if (!ROMPatcher_Reader_ReadNumber(reader, &source_size) || !ROMPatcher_Reader_ReadNumber(reader, &context->target_size) || !ROMPatcher_Reader_ReadNumber(reader, &metadata_size))
+		return cc_false;
+
+	if (source_size != context->source_size || context->target_size > context->capacity)
+		return cc_false;
+
+	/* Check this first, so that a bogus size cannot make this read byte-by-byte for a long time. */
+	if (metadata_size > patch_size || reader->position > patch_size - metadata_size)
+		return cc_false;
+
+	for (i = 0; i < metadata_size && !reader->failed; ++i)
+		ROMPatcher_Reader_ReadByte(reader);
+
+	while (reader->position < patch_size - ROMPATCHER_FOOTER_SIZE)
+	{
+		size_t data, length, relative_offset;
+
+		if (!ROMPatcher_Reader_ReadNumber(reader, &data))
+			return cc_false;
+
+		length = (data >> 2) + 1;
+
+		if (length > context->target_size - output_offset)
+			return cc_false;
+
+		switch (data & 3)
+		{
+			case SOURCE_READ:
+				/* Since the output starts as a copy of the ROM, the data is already there! */
+				if (output_offset + length > source_size)
+					return cc_false;
+
+				break;
+
+			case TARGET_READ:
+				for (i = 0; i < length; ++i)
+				{
+					const unsigned char byte = ROMPatcher_Reader_ReadByte(reader);
+
+					if (context->apply)
+						ROMPatcher_SetByte(context->rom, output_offset + i, byte);
+				}
+
+				break;
+
+			case SOURCE_COPY:
+			case TARGET_COPY:
+				if (!ROMPatcher_Reader_ReadNumber(reader, &relative_offset))
+					return cc_false;
+
+				if ((data & 3) == SOURCE_COPY)
+				{
+					/* Relative offsets are signed, with the sign in the lowest bit. */
+					if ((relative_offset & 1) != 0 ? (relative_offset >> 1) > source_offset : (relative_offset >> 1) > source_size - source_offset)
+						return cc_false;
+
+					source_offset = (relative_offset & 1) != 0 ? source_offset - (relative_offset >> 1) : source_offset + (relative_offset >> 1);
+
+					if (length > source_size - source_offset)
+						return cc_false;
+
+					if (context->apply)
+						for (i = 0; i < length; ++i)
+							ROMPatcher_SetByte(context->rom, output_offset + i, ROMPatcher_GetByte(context->source, source_offset + i));
+
+					source_offset += length;
+				}
+				else
+				{
+					if ((relative_offset & 1) != 0 ? (relative_offset >> 1) > target_offset : (relative_offset >> 1) > output_offset - target_offset)
+						return cc_false;
+
+					target_offset = (relative_offset & 1) != 0 ? target_offset - (relative_offset >> 1) : target_offset + (relative_offset >> 1);
+
+					/* Only data that has already been output can be copied. This may overlap with the output, like LZ77. */
+					if (target_offset >= output_offset)
+						return cc_false;
+
+					if (context->apply)
+						for (i = 0; i < length; ++i)
+							ROMPatcher_SetByte(context->rom, output_offset + i, ROMPatcher_GetByte(context->rom, target_offset + i));
+
+					target_offset += length;
+				}
+
+				break;
+		}
+
+		if (reader->failed)
+			return cc_false;
+
+		output_offset += length;
+	}
+
+	if (output_offset != context->target_size)
+		return cc_false;
+
+	return ROMPatcher_Reader_ReadFooter(reader, context, patch_size);
+}
+
+static cc_bool ROMPatcher_Process(ROMPatcher_Reader* const reader, ROMPatcher_Context* const context, const ROMPatcher_Format format, const size_t patch_size)
+{
+	/* Skip the magic number. */
+	if (!ROMPatcher_Reader_Read(reader, context->footer, format == ROMPATCHER_FORMAT_IPS ? 5 : 4))
+		return cc_false;
+
+	switch (format)
+	{
+		case ROMPATCHER_FORMAT_IPS:
+			return ROMPatcher_ProcessIPS(reader, context, patch_size);
+
+		case ROMPATCHER_FORMAT_UPS:
+			return ROMPatcher_ProcessUPS(reader, context, patch_size);
+
+		case ROMPATCHER_FORMAT_BPS:
+			return ROMPatcher_ProcessBPS(reader, context, patch_size);
+	}
+
+	return cc_false;
+}
+
+/* API */
+
+cc_u32f ROMPatcher_HashROM(const cc_u16l* const rom, const size_t rom_size)
+{
+	unsigned char buffer[0x400];
+	cc_u32f hash = 0;
+	size_t position = 0;
+
+	while (position != rom_size)
+	{
+		const size_t total_bytes = CC_MIN(rom_size - position, sizeof(buffer));
+
+		size_t i;
+
+		for (i = 0; i < total_bytes; ++i)
+			buffer[i] = ROMPatcher_GetByte(rom, position + i);
+
+		hash = CRC32_Update(hash, buffer, total_bytes);
+		position += total_bytes;
+	}
+
+	return hash;
+}
+
+cc_bool ROMPatcher_HashPatch(void* const stream, const ROMPatcher_Callbacks* const callbacks, cc_u32f* const hash)
+{
+	unsigned char buffer[0x1000];
+	size_t bytes_read;
+
+	if (!callbacks->seek(stream, 0))
+		return cc_false;
+
+	*hash = 0;
+
+	while ((bytes_read = callbacks->read(stream, buffer, sizeof(buffer))) != 0)
+		*hash = CRC32_Update(*hash, buffer, bytes_read);
+
+	return cc_true;
+}
+
+cc_bool ROMPatcher_Apply(cc_u16l* const rom, size_t* const rom_size, const size_t rom_capacity, void* const stream, const ROMPatcher_Callbacks* const callbacks, const size_t patch_size, ROMPatcher_Result* const result)
+{
+	ROMPatcher_Reader reader_storage;
+	ROMPatcher_Reader* const reader = &reader_storage;
+	ROMPatcher_Context context;
+	unsigned char magic[5];
+	size_t i;
+	cc_u16l *output = rom;
+	cc_bool success;
+
+	/* Identify the format. */
+	if (!callbacks->seek(stream, 0) || callbacks->read(stream, magic, sizeof(magic)) != sizeof(magic))
+		return cc_false;
+
+	if (memcmp(magic, "PATCH", 5) == 0)
+		result->format = ROMPATCHER_FORMAT_IPS;
+	else if (memcmp(magic, "UPS1", 4) == 0)
+		result->format = ROMPATCHER_FORMAT_UPS;
+	else if (memcmp(magic, "BPS1", 4) == 0)
+		result->format = ROMPATCHER_FORMAT_BPS;
+	else
+		return cc_false;
+
+	if (result->format != ROMPATCHER_FORMAT_IPS && patch_size < 4 + ROMPATCHER_FOOTER_SIZE)
+		return cc_false;
+
+	context.rom = rom;
+	context.source = rom;
+	/* The ROM is made of whole words, so an odd capacity has a byte which cannot be used. */
+	context.capacity = rom_capacity / 2 * 2;
+	context.source_size = *rom_size;
+	context.target_size = 0;
+
+	/* First pass: validate and hash the patch without modifying the ROM.
+	   The patch's own checksum excludes itself, so it is left out of the hash until the end. */
+	context.apply = cc_false;
+
+	if (!ROMPatcher_Reader_Begin(reader, stream, callbacks, result->format == ROMPATCHER_FORMAT_IPS ? patch_size : patch_size - 4))
+		return cc_false;
+
+	if (!ROMPatcher_Process(reader, &context, result->format, patch_size))
+		return cc_false;
+
+	/* Make sure that anything after the end of the patch data is hashed too. */
+	while (reader->position < patch_size && !reader->failed)
+		ROMPatcher_Reader_ReadByte(reader);
+
+	if (context.target_size > context.capacity)
+		return cc_false;
+
+	result->rom_hash = ROMPatcher_HashROM(rom, *rom_size);
+
+	if (result->format == ROMPATCHER_FORMAT_IPS)
+	{
+		result->patch_hash = reader->hash;
+	}
+	else
+	{
+		if (reader->hash != ROMPatcher_ReadU32LE(&context.footer[8]))
+			return cc_false;
+
+		if (result->rom_hash != ROMPatcher_ReadU32LE(&context.footer[0]))
+			return cc_false;
+
+		result->patch_hash = CRC32_Update(reader->hash, &context.footer[8], 4);
+
+		/* The patched ROM's checksum can only be verified once the patch has been applied, so apply it to a
+		   copy, leaving the ROM untouched if it does not match. This also lets BPS patches read the original
+		   data after overwriting it. IPS patches have no such checksum, so they are applied in place. */
+		output = (cc_u16l*)calloc(context.target_size / 2 + 1, sizeof(cc_u16l));
+
+		if (output == NULL)
+			return cc_false;
+
+		for (i = 0; i < CC_MIN(context.source_size, context.target_size); ++i)
+			ROMPatcher_SetByte(output, i, ROMPatcher_GetByte(rom, i));
+
+		context.rom = output;
+	}
+
+	/* Any expansion of the ROM starts out blank, which UPS and IPS rely on. */
+	for (i = context.source_size; i < context.target_size; ++i)
+		ROMPatcher_SetByte(output, i, 0);
+
+	/* Second pass: apply the patch. This cannot fail unless the stream changes between passes. */
+	context.apply = cc_true;
+
+	success = ROMPatcher_Reader_Begin(reader, stream, callbacks, 0) && ROMPatcher_Process(reader, &context, result->format, patch_size);
+
+	if (success)
+	{
+		/* Blank the unused half of the last word. */
+		if (context.target_size % 2 != 0)
+			ROMPatcher_SetByte(output, context.target_size, 0);
+
+		result->patched_rom_hash = ROMPatcher_HashROM(output, context.target_size);
+
+		if (output != rom)
+		{
+			success = result->patched_rom_hash == ROMPatcher_ReadU32LE(&context.footer[4]);
+
+			if (success)
+				memcpy(rom, output, CC_MIN((context.target_size + 1) / 2, context.capacity / 2) * sizeof(*rom));
+		}
+	}
+
+	if (output != rom)
+		free(output);
+
+	if (!success)
+		return cc_false;
+
+	*rom_size = context.target_size;
+
+	return cc_true;
+}
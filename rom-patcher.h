@@ -0,0 +1,54 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_ROM_PATCHER_H
+#define CLOWNMDEMU_FRONTEND_COMMON_ROM_PATCHER_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+
+/* Applies IPS, UPS, and BPS patches directly to a ROM buffer, streaming the patch
+   instead of loading it into memory. Unlike the cheat manager, sizes are in bytes.
+
+   Patches are validated in full before the ROM is modified, so a bad patch or a
+   ROM which the patch was not made for will leave the ROM untouched. UPS and BPS
+   patches are applied to a temporary copy of the ROM, so that the patched ROM's
+   checksum can be verified too.
+
+   Patching can be skipped on later boots by caching the patched ROM under the
+   pair of hashes produced by 'ROMPatcher_HashROM' and 'ROMPatcher_HashPatch'. */
+
+typedef enum ROMPatcher_Format
+{
+	ROMPATCHER_FORMAT_IPS,
+	ROMPATCHER_FORMAT_UPS,
+	ROMPATCHER_FORMAT_BPS
+} ROMPatcher_Format;
+
+typedef struct ROMPatcher_Callbacks
+{
+	/* Returns the number of bytes read, which is 0 at the end of the file. */
+	size_t (*read)(void *stream, unsigned char *buffer, size_t size);
+	cc_bool (*seek)(void *stream, size_t position);
+} ROMPatcher_Callbacks;
+
+typedef struct ROMPatcher_Result
+{
+	ROMPatcher_Format format;
+	/* These are all CRC-32s. */
+	cc_u32l rom_hash;
+	cc_u32l patch_hash;
+	cc_u32l patched_rom_hash;
+} ROMPatcher_Result;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cc_u32f ROMPatcher_HashROM(const cc_u16l *rom, size_t rom_size);
+cc_bool ROMPatcher_HashPatch(void *stream, const ROMPatcher_Callbacks *callbacks, cc_u32f *hash);
+cc_bool ROMPatcher_Apply(cc_u16l *rom, size_t *rom_size, size_t rom_capacity, void *stream, const ROMPatcher_Callbacks *callbacks, size_t patch_size, ROMPatcher_Result *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_ROM_PATCHER_H */
@@ -0,0 +1,103 @@
+#include "run-ahead.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mixer.h"
+
+#define RUNAHEAD_EMULATOR_SIZE sizeof(((const ClownMDEmu*)NULL)->state)
+
+static void RunAhead_DiscardAudio(void* const user_data, const cc_s16l* const audio_samples, const size_t total_frames)
+{
+	(void)user_data;
+	(void)audio_samples;
+	(void)total_frames;
+}
+
+static void RunAhead_RunFrame(const RunAhead_State* const state, ClownMDEmu* const clownmdemu, CheatManager* const cheat_manager, Mixer_State* const mixer, const cc_bool speculative, const cc_bool display)
+{
+	const RunAhead_Callbacks* const callbacks = state->callbacks;
+
+	/* Speculative frames still need to begin a new mixer frame, otherwise their audio would overflow the buffers. */
+	if (mixer != NULL)
+		Mixer_Begin(mixer);
+
+	if (cheat_manager != NULL)
+		CheatManager_ApplyRAMPatches(cheat_manager, clownmdemu);
+
+	callbacks->frame_run((void*)callbacks->user_data, clownmdemu, speculative, display);
+
+	if (mixer != NULL && !speculative)
+		Mixer_End(mixer, callbacks->audio_output != NULL ? callbacks->audio_output : RunAhead_DiscardAudio, callbacks->user_data);
+}
+
+cc_bool RunAhead_Initialise(RunAhead_State* const state, const RunAhead_Callbacks* const callbacks, ClownMDEmu* const secondary)
+{
+	state->callbacks = callbacks;
+	state->secondary = secondary;
+	state->frames = 0;
+
+	/* There is no need to back anything up when speculating on a second emulator. */
+	if (secondary != NULL)
+	{
+		state->backup = NULL;
+		return cc_true;
+	}
+
+	state->backup = (unsigned char*)malloc(RUNAHEAD_EMULATOR_SIZE);
+
+	return state->backup != NULL;
+}
+
+void RunAhead_Deinitialise(RunAhead_State* const state)
+{
+	free(state->backup);
+}
+
+void RunAhead_SetFrames(RunAhead_State* const state, const unsigned int frames)
+{
+	state->frames = CC_MIN(RUNAHEAD_MAXIMUM_FRAMES, frames);
+}
+
+void RunAhead_Frame(RunAhead_State* const state, ClownMDEmu* const clownmdemu, CDReader_State* const cd_reader, CheatManager* const cheat_manager, Mixer_State* const mixer)
+{
+	ClownMDEmu* const speculator = state->secondary != NULL ? state->secondary : clownmdemu;
+	const cc_bool backup_cd_reader = cd_reader != NULL && CDReader_IsOpen(cd_reader);
+
+	CDReader_StateBackup cd_reader_before, cd_reader_after;
+	unsigned int i;
+
+	RunAhead_RunFrame(state, clownmdemu, cheat_manager, mixer, cc_false, state->frames == 0);
+
+	if (state->frames == 0)
+		return;
+
+	/* Back up everything that speculation can change. */
+	if (state->secondary != NULL)
+		memcpy(&state->secondary->state, &clownmdemu->state, RUNAHEAD_EMULATOR_SIZE);
+	else
+		memcpy(state->backup, &clownmdemu->state, RUNAHEAD_EMULATOR_SIZE);
+
+	if (backup_cd_reader)
+		CDReader_SaveState(cd_reader, &cd_reader_before);
+
+	for (i = 1; i <= state->frames; ++i)
+		RunAhead_RunFrame(state, speculator, cheat_manager, mixer, cc_true, i == state->frames);
+
+	/* Roll back. */
+	if (state->secondary == NULL)
+		memcpy(&clownmdemu->state, state->backup, RUNAHEAD_EMULATOR_SIZE);
+
+	if (backup_cd_reader)
+	{
+		/* Seeking can be slow, so avoid it if the speculative frames did not touch the CD. */
+		CDReader_SaveState(cd_reader, &cd_reader_after);
+
+		if (cd_reader_after.track_index != cd_reader_before.track_index
+		 || cd_reader_after.frame_index != cd_reader_before.frame_index
+		 || cd_reader_after.playback_setting != cd_reader_before.playback_setting
+		 || cd_reader_after.audio_playing != cd_reader_before.audio_playing)
+			CDReader_LoadState(cd_reader, &cd_reader_before);
+	}
+}
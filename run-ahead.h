@@ -0,0 +1,121 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_RUN_AHEAD_H
+#define CLOWNMDEMU_FRONTEND_COMMON_RUN_AHEAD_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+#include "core/source/clownmdemu.h"
+
+#include "cd-reader.h"
+#include "cheat.h"
+
+/* Reduces input latency by emulating frames ahead of time, displaying the
+   last of them, and then rolling back to the first.
+
+   Each call to 'RunAhead_Frame' emulates one 'real' frame, whose audio is
+   output, followed by a number of 'speculative' frames, whose audio is
+   discarded and whose effects on the emulator, CD reader, and cheats are
+   undone afterwards. Only the video of the final frame should be displayed.
+
+   Normally, the emulator state is backed up before speculating and restored
+   afterwards. If a second emulator is provided, then it speculates instead,
+   using a copy of the first emulator's state, so nothing needs restoring.
+   It should be set up identically to the first emulator, except that its
+   audio and save file callbacks may do nothing.
+
+   The CD reader, cheat manager, and mixer are optional, and may be NULL. */
+
+#define RUNAHEAD_MAXIMUM_FRAMES 8
+
+/* 'mixer.h' is not included here, since it may contain its implementation. */
+struct Mixer_State;
+
+typedef struct RunAhead_Callbacks
+{
+	const void *user_data;
+	/* Called to emulate a single frame. The video should only be displayed if 'display' is true.
+	   When 'speculative' is true, the frontend can also skip work like decoding CD audio. */
+	void (*frame_run)(void *user_data, ClownMDEmu *clownmdemu, cc_bool speculative, cc_bool display);
+	/* Receives the mixed audio of the real frames, just like a 'Mixer_Callback'. */
+	void (*audio_output)(void *user_data, const cc_s16l *audio_samples, size_t total_frames);
+} RunAhead_Callbacks;
+
+typedef struct RunAhead_State
+{
+	const RunAhead_Callbacks *callbacks;
+	ClownMDEmu *secondary;
+	unsigned char *backup;
+	unsigned int frames;
+} RunAhead_State;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cc_bool RunAhead_Initialise(RunAhead_State *state, const RunAhead_Callbacks *callbacks, ClownMDEmu *secondary);
+void RunAhead_Deinitialise(RunAhead_State *state);
+void RunAhead_SetFrames(RunAhead_State *state, unsigned int frames);
+void RunAhead_Frame(RunAhead_State *state, ClownMDEmu *clownmdemu, CDReader_State *cd_reader, CheatManager *cheat_manager, struct Mixer_State *mixer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <cassert>
+#include <utility>
+
+class RunAhead
+{
+protected:
+	RunAhead_State state;
+	bool initialised;
+
+public:
+	RunAhead(const RunAhead_Callbacks* const callbacks, ClownMDEmu* const secondary = nullptr)
+	{
+		initialised = RunAhead_Initialise(&state, callbacks, secondary);
+	}
+	RunAhead(const RunAhead &other) = delete;
+	RunAhead(RunAhead &&other)
+		: state(other.state)
+		, initialised(other.initialised)
+	{
+		other.initialised = false;
+	}
+	RunAhead& operator=(const RunAhead &other) = delete;
+	RunAhead& operator=(RunAhead &&other)
+	{
+		std::swap(state, other.state);
+		std::swap(initialised, other.initialised);
+		return *this;
+	}
+
+	~RunAhead()
+	{
+		if (initialised)
+			RunAhead_Deinitialise(&state);
+	}
+
+	bool Initialised() const
+	{
+		return initialised;
+	}
+
+	void SetFrames(const unsigned int frames)
+	{
+		assert(Initialised());
+		RunAhead_SetFrames(&state, frames);
+	}
+
+	void Frame(ClownMDEmu* const clownmdemu, CDReader_State* const cd_reader, CheatManager* const cheat_manager, struct Mixer_State* const mixer)
+	{
+		assert(Initialised());
+		RunAhead_Frame(&state, clownmdemu, cd_reader, cheat_manager, mixer);
+	}
+};
+
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_RUN_AHEAD_H */
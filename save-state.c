@@ -0,0 +1,264 @@
+#include "save-state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc32.h"
+#include "delta.h"
+
+#define SAVESTATE_MAGIC "CMDS"
+#define SAVESTATE_HEADER_SIZE (4 + 2 + 2)
+/* The identifier, uncompressed size, encoded size, and CRC-32. */
+#define SAVESTATE_CHUNK_HEADER_SIZE (4 + 4 + 4 + 4)
+
+#define SAVESTATE_EMULATOR_SIZE sizeof(((const ClownMDEmu*)NULL)->state)
+/* The track index, frame index, playback setting, and whether audio is playing. */
+#define SAVESTATE_CD_READER_SIZE (2 + 4 + 1 + 1)
+
+#define SAVESTATE_CD_READER_OFFSET SAVESTATE_EMULATOR_SIZE
+#define SAVESTATE_CHEATS_OFFSET (SAVESTATE_CD_READER_OFFSET + SAVESTATE_CD_READER_SIZE)
+#define SAVESTATE_CAPTURE_SIZE (SAVESTATE_CHEATS_OFFSET + CHEATMANAGER_SNAPSHOT_MAXIMUM_SERIALISED_SIZE)
+
+#define SAVESTATE_MAXIMUM_ENCODED_SIZE (SAVESTATE_HEADER_SIZE + SAVESTATE_CHUNK_HEADER_SIZE * SAVESTATE_CHUNK_TOTAL + DELTA_MAXIMUM_ENCODED_SIZE(SAVESTATE_EMULATOR_SIZE) + DELTA_MAXIMUM_ENCODED_SIZE(SAVESTATE_CD_READER_SIZE) + DELTA_MAXIMUM_ENCODED_SIZE(CHEATMANAGER_SNAPSHOT_MAXIMUM_SERIALISED_SIZE))
+
+enum
+{
+	SAVESTATE_CHUNK_EMULATOR,
+	SAVESTATE_CHUNK_CD_READER,
+	SAVESTATE_CHUNK_CHEATS,
+
+	/* Ignore this; this is just the total number of enums. */
+	SAVESTATE_CHUNK_TOTAL
+};
+
+static const char chunk_identifiers[SAVESTATE_CHUNK_TOTAL][4] = {
+	{'E', 'M', 'U', 'L'},
+	{'C', 'D', 'R', 'D'},
+	{'C', 'H', 'E', 'T'}
+};
+
+static const size_t chunk_offsets[SAVESTATE_CHUNK_TOTAL] = {
+	0,
+	SAVESTATE_CD_READER_OFFSET,
+	SAVESTATE_CHEATS_OFFSET
+};
+
+/* Everything is big-endian, so that the format does not depend on the host (apart from the emulator's state itself). */
+
+static unsigned char* SaveState_WriteNumber(unsigned char *output, const unsigned long value, const cc_u8f total_bytes)
+{
+	cc_u8f i;
+
+	for (i = total_bytes; i-- != 0; )
+		*output++ = (value >> (i * 8)) & 0xFF;
+
+	return output;
+}
+
+static unsigned long SaveState_ReadNumber(const unsigned char* const input, const cc_u8f total_bytes)
+{
+	unsigned long value = 0;
+	cc_u8f i;
+
+	for (i = 0; i < total_bytes; ++i)
+		value = value << 8 | input[i];
+
+	return value;
+}
+
+cc_bool SaveState_Initialise(SaveState_State* const state)
+{
+	state->capture = (unsigned char*)malloc(SAVESTATE_CAPTURE_SIZE);
+	state->encoded = (unsigned char*)malloc(SAVESTATE_MAXIMUM_ENCODED_SIZE);
+	state->cd_reader_captured = cc_false;
+	state->cheats_size = 0;
+	state->encoded_size = 0;
+
+	if (state->capture == NULL || state->encoded == NULL)
+	{
+		SaveState_Deinitialise(state);
+		return cc_false;
+	}
+
+	return cc_true;
+}
+
+void SaveState_Deinitialise(SaveState_State* const state)
+{
+	free(state->capture);
+	free(state->encoded);
+}
+
+void SaveState_Capture(SaveState_State* const state, const ClownMDEmu* const clownmdemu, const CDReader_State* const cd_reader, const CheatManager* const cheat_manager)
+{
+	memcpy(&state->capture[0], &clownmdemu->state, SAVESTATE_EMULATOR_SIZE);
+
+	state->cd_reader_captured = cd_reader != NULL;
+
+	if (cd_reader != NULL)
+	{
+		CDReader_StateBackup backup;
+		unsigned char *output = &state->capture[SAVESTATE_CD_READER_OFFSET];
+
+		CDReader_SaveState(cd_reader, &backup);
+
+		output = SaveState_WriteNumber(output, backup.track_index, 2);
+		output = SaveState_WriteNumber(output, backup.frame_index, 4);
+		output = SaveState_WriteNumber(output, backup.playback_setting, 1);
+		output = SaveState_WriteNumber(output, backup.audio_playing, 1);
+	}
+
+	state->cheats_size = 0;
+
+	if (cheat_manager != NULL)
+	{
+		CheatManager_Snapshot snapshot;
+
+		CheatManager_SaveSnapshot(cheat_manager, &snapshot);
+		state->cheats_size = CheatManager_SerialiseSnapshot(&snapshot, &state->capture[SAVESTATE_CHEATS_OFFSET]);
+	}
+}
+
+void SaveState_Encode(SaveState_State* const state)
+{
+	size_t chunk_sizes[SAVESTATE_CHUNK_TOTAL];
+	unsigned char *output = state->encoded;
+	cc_u8f total_chunks = 0;
+	cc_u8f i;
+
+	chunk_sizes[SAVESTATE_CHUNK_EMULATOR] = SAVESTATE_EMULATOR_SIZE;
+	chunk_sizes[SAVESTATE_CHUNK_CD_READER] = state->cd_reader_captured ? SAVESTATE_CD_READER_SIZE : 0;
+	chunk_sizes[SAVESTATE_CHUNK_CHEATS] = state->cheats_size;
+
+	for (i = 0; i < SAVESTATE_CHUNK_TOTAL; ++i)
+		if (chunk_sizes[i] != 0)
+			++total_chunks;
+
+	memcpy(output, SAVESTATE_MAGIC, 4);
+	output += 4;
+	output = SaveState_WriteNumber(output, SAVESTATE_VERSION, 2);
+	output = SaveState_WriteNumber(output, total_chunks, 2);
+
+	for (i = 0; i < SAVESTATE_CHUNK_TOTAL; ++i)
+	{
+		const unsigned char* const data = &state->capture[chunk_offsets[i]];
+		unsigned char* const header = output;
+		size_t encoded_size;
+
+		if (chunk_sizes[i] == 0)
+			continue;
+
+		/* The emulator's state is mostly zeroes, so skipping runs of them compresses it well, and very quickly. */
+		encoded_size = Delta_Encode(header + SAVESTATE_CHUNK_HEADER_SIZE, data, NULL, chunk_sizes[i]);
+
+		memcpy(header, chunk_identifiers[i], 4);
+		SaveState_WriteNumber(header + 4, chunk_sizes[i], 4);
+		SaveState_WriteNumber(header + 8, encoded_size, 4);
+		SaveState_WriteNumber(header + 12, CRC32_Update(0, data, chunk_sizes[i]), 4);
+
+		output = header + SAVESTATE_CHUNK_HEADER_SIZE + encoded_size;
+	}
+
+	state->encoded_size = output - state->encoded;
+}
+
+const unsigned char* SaveState_GetEncoded(const SaveState_State* const state, size_t* const size)
+{
+	*size = state->encoded_size;
+	return state->encoded;
+}
+
+cc_bool SaveState_Load(SaveState_State* const state, const unsigned char* const data, const size_t size, ClownMDEmu* const clownmdemu, CDReader_State* const cd_reader, CheatManager* const cheat_manager, cc_u16l* const rom, const size_t rom_length)
+{
+	const unsigned char *input = data;
+	const unsigned char* const input_end = data + size;
+
+	size_t chunk_sizes[SAVESTATE_CHUNK_TOTAL] = {0, 0, 0};
+	CheatManager_Snapshot snapshot;
+	unsigned int total_chunks, i;
+
+	if (size < SAVESTATE_HEADER_SIZE || memcmp(input, SAVESTATE_MAGIC, 4) != 0 || SaveState_ReadNumber(input + 4, 2) > SAVESTATE_VERSION)
+		return cc_false;
+
+	total_chunks = SaveState_ReadNumber(input + 6, 2);
+	input += SAVESTATE_HEADER_SIZE;
+
+	/* Decode and verify everything before touching the emulator, so that a bad file leaves it as it was. */
+	for (i = 0; i < total_chunks; ++i)
+	{
+		static const size_t maximum_sizes[SAVESTATE_CHUNK_TOTAL] = {
+			SAVESTATE_EMULATOR_SIZE,
+			SAVESTATE_CD_READER_SIZE,
+			CHEATMANAGER_SNAPSHOT_MAXIMUM_SERIALISED_SIZE
+		};
+
+		unsigned long uncompressed_size, encoded_size;
+		cc_u8f chunk;
+
+		if ((size_t)(input_end - input) < SAVESTATE_CHUNK_HEADER_SIZE)
+			return cc_false;
+
+		uncompressed_size = SaveState_ReadNumber(input + 4, 4);
+		encoded_size = SaveState_ReadNumber(input + 8, 4);
+
+		if (encoded_size > (size_t)(input_end - input) - SAVESTATE_CHUNK_HEADER_SIZE)
+			return cc_false;
+
+		for (chunk = 0; chunk < SAVESTATE_CHUNK_TOTAL; ++chunk)
+			if (memcmp(input, chunk_identifiers[chunk], 4) == 0)
+				break;
+
+		/* Skip chunks from newer versions of the format. */
+		if (chunk != SAVESTATE_CHUNK_TOTAL)
+		{
+			unsigned char* const output = &state->capture[chunk_offsets[chunk]];
+
+			/* A different emulator state size means that it is from an incompatible build of the core. */
+			if (chunk == SAVESTATE_CHUNK_CHEATS ? uncompressed_size > maximum_sizes[chunk] : uncompressed_size != maximum_sizes[chunk])
+				return cc_false;
+
+			/* The data is decoded relative to zeroes. */
+			memset(output, 0, uncompressed_size);
+
+			if (Delta_Decode(output, uncompressed_size, input + SAVESTATE_CHUNK_HEADER_SIZE, encoded_size) != encoded_size)
+				return cc_false;
+
+			if (CRC32_Update(0, output, uncompressed_size) != SaveState_ReadNumber(input + 12, 4))
+				return cc_false;
+
+			chunk_sizes[chunk] = uncompressed_size;
+		}
+
+		input += SAVESTATE_CHUNK_HEADER_SIZE + encoded_size;
+	}
+
+	if (chunk_sizes[SAVESTATE_CHUNK_EMULATOR] == 0)
+		return cc_false;
+
+	/* Otherwise, the CD reader would be left wherever it was, out of step with the emulator. */
+	if (cd_reader != NULL && chunk_sizes[SAVESTATE_CHUNK_CD_READER] == 0)
+		return cc_false;
+
+	if (chunk_sizes[SAVESTATE_CHUNK_CHEATS] != 0 && !CheatManager_DeserialiseSnapshot(&snapshot, &state->capture[SAVESTATE_CHEATS_OFFSET], chunk_sizes[SAVESTATE_CHUNK_CHEATS]))
+		return cc_false;
+
+	memcpy(&clownmdemu->state, &state->capture[0], SAVESTATE_EMULATOR_SIZE);
+
+	if (cd_reader != NULL)
+	{
+		const unsigned char* const cd_reader_data = &state->capture[SAVESTATE_CD_READER_OFFSET];
+		CDReader_StateBackup backup;
+
+		backup.track_index = SaveState_ReadNumber(cd_reader_data + 0, 2);
+		backup.frame_index = SaveState_ReadNumber(cd_reader_data + 2, 4);
+		backup.playback_setting = (CDReader_PlaybackSetting)SaveState_ReadNumber(cd_reader_data + 6, 1);
+		backup.audio_playing = SaveState_ReadNumber(cd_reader_data + 7, 1) != 0;
+
+		CDReader_LoadState(cd_reader, &backup);
+	}
+
+	if (cheat_manager != NULL && chunk_sizes[SAVESTATE_CHUNK_CHEATS] != 0)
+		CheatManager_LoadSnapshot(cheat_manager, rom, rom_length, &snapshot);
+
+	return cc_true;
+}
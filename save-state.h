@@ -0,0 +1,130 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_SAVE_STATE_H
+#define CLOWNMDEMU_FRONTEND_COMMON_SAVE_STATE_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+#include "core/source/clownmdemu.h"
+
+#include "cd-reader.h"
+#include "cheat.h"
+
+/* A save-state file format shared between frontends.
+
+   The file is a small header followed by a list of chunks: the emulator's
+   state, the CD reader's state, and the cheats. Each chunk is compressed and
+   has a CRC-32 of its contents, and unknown chunks are skipped, so that new
+   ones can be added without breaking older frontends.
+
+   Saving is split into two steps so that the frame loop is not stalled:
+   'SaveState_Capture' quickly copies the state into a buffer, after which
+   'SaveState_Encode' can compress it and the result can be written to disk on
+   another thread. Neither 'SaveState_Capture' nor 'SaveState_Load' may be
+   called again until that is done. Both buffers are allocated once, and
+   loading decodes into the capture buffer, so neither saving nor loading
+   allocates any memory.
+
+   The CD reader and cheat manager are optional, and may be NULL. However, a
+   state which was saved without a CD reader cannot be loaded with one, since
+   there would be nothing to restore its position from. */
+
+#define SAVESTATE_VERSION 1
+
+typedef struct SaveState_State
+{
+	/* The unencoded chunks, laid out back-to-back. */
+	unsigned char *capture;
+	cc_bool cd_reader_captured;
+	size_t cheats_size;
+
+	/* The file. */
+	unsigned char *encoded;
+	size_t encoded_size;
+} SaveState_State;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cc_bool SaveState_Initialise(SaveState_State *state);
+void SaveState_Deinitialise(SaveState_State *state);
+void SaveState_Capture(SaveState_State *state, const ClownMDEmu *clownmdemu, const CDReader_State *cd_reader, const CheatManager *cheat_manager);
+void SaveState_Encode(SaveState_State *state);
+const unsigned char* SaveState_GetEncoded(const SaveState_State *state, size_t *size);
+cc_bool SaveState_Load(SaveState_State *state, const unsigned char *data, size_t size, ClownMDEmu *clownmdemu, CDReader_State *cd_reader, CheatManager *cheat_manager, cc_u16l *rom, size_t rom_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+class SaveState
+{
+protected:
+	SaveState_State state;
+	bool initialised;
+
+public:
+	SaveState()
+	{
+		initialised = SaveState_Initialise(&state);
+	}
+	SaveState(const SaveState &other) = delete;
+	SaveState(SaveState &&other)
+		: state(other.state)
+		, initialised(other.initialised)
+	{
+		other.initialised = false;
+	}
+	SaveState& operator=(const SaveState &other) = delete;
+	SaveState& operator=(SaveState &&other)
+	{
+		std::swap(state, other.state);
+		std::swap(initialised, other.initialised);
+		return *this;
+	}
+
+	~SaveState()
+	{
+		if (initialised)
+			SaveState_Deinitialise(&state);
+	}
+
+	bool Initialised() const
+	{
+		return initialised;
+	}
+
+	void Capture(const ClownMDEmu* const clownmdemu, const CDReader_State* const cd_reader, const CheatManager* const cheat_manager)
+	{
+		assert(Initialised());
+		SaveState_Capture(&state, clownmdemu, cd_reader, cheat_manager);
+	}
+
+	void Encode()
+	{
+		assert(Initialised());
+		SaveState_Encode(&state);
+	}
+
+	const unsigned char* GetEncoded(std::size_t &size) const
+	{
+		assert(Initialised());
+		return SaveState_GetEncoded(&state, &size);
+	}
+
+	bool Load(const unsigned char* const data, const std::size_t size, ClownMDEmu* const clownmdemu, CDReader_State* const cd_reader, CheatManager* const cheat_manager, cc_u16l* const rom, const std::size_t rom_length)
+	{
+		assert(Initialised());
+		return SaveState_Load(&state, data, size, clownmdemu, cd_reader, cheat_manager, rom, rom_length);
+	}
+};
+
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_SAVE_STATE_H */
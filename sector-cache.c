@@ -0,0 +1,109 @@
+#include "sector-cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SECTORCACHE_SECTOR_WORDS (CDREADER_SECTOR_SIZE / 2)
+
+cc_bool SectorCache_Initialise(SectorCache* const cache, CDReader_State* const cd_reader, const CDReader_SectorIndex maximum_sectors)
+{
+	CDReader_StateBackup backup;
+	CDReader_SectorIndex i;
+
+	cache->total_sectors = 0;
+	cache->sectors = (cc_u16l*)malloc((size_t)maximum_sectors * SECTORCACHE_SECTOR_WORDS * sizeof(cc_u16l));
+
+	if (cache->sectors == NULL)
+		return cc_false;
+
+	if (CDReader_IsOpen(cd_reader))
+	{
+		/* Put the CD reader back where it was afterwards, so that this does not disturb the emulator that owns it. */
+		CDReader_SaveState(cd_reader, &backup);
+
+		/* Stop at the end of the data track. */
+		if (CDReader_SeekToSector(cd_reader, 0))
+		{
+			for (i = 0; i < maximum_sectors; ++i)
+			{
+				if (!CDReader_ReadSector(cd_reader, &cache->sectors[(size_t)i * SECTORCACHE_SECTOR_WORDS]))
+					break;
+
+				++cache->total_sectors;
+			}
+		}
+
+		CDReader_LoadState(cd_reader, &backup);
+	}
+
+	/* Give back whatever was not needed. */
+	if (cache->total_sectors == 0)
+	{
+		free(cache->sectors);
+		cache->sectors = NULL;
+	}
+	else if (cache->total_sectors != maximum_sectors)
+	{
+		cc_u16l* const sectors = (cc_u16l*)realloc(cache->sectors, (size_t)cache->total_sectors * SECTORCACHE_SECTOR_WORDS * sizeof(cc_u16l));
+
+		if (sectors != NULL)
+			cache->sectors = sectors;
+	}
+
+	return cc_true;
+}
+
+void SectorCache_Deinitialise(SectorCache* const cache)
+{
+	free(cache->sectors);
+}
+
+const cc_u16l* SectorCache_GetSector(const SectorCache* const cache, const CDReader_SectorIndex sector_index)
+{
+	if (sector_index >= cache->total_sectors)
+		return NULL;
+
+	return &cache->sectors[(size_t)sector_index * SECTORCACHE_SECTOR_WORDS];
+}
+
+void SectorCache_Reader_Initialise(SectorCache_Reader* const reader, const SectorCache* const cache, CDReader_State* const cd_reader)
+{
+	reader->cache = cache;
+	reader->cd_reader = cd_reader;
+	reader->position = 0;
+	reader->cd_reader_in_position = cc_false;
+}
+
+void SectorCache_Reader_SeekToSector(SectorCache_Reader* const reader, const CDReader_SectorIndex sector_index)
+{
+	/* The CD reader is only seeked when a sector is not in the cache. */
+	reader->position = sector_index;
+	reader->cd_reader_in_position = cc_false;
+}
+
+cc_bool SectorCache_Reader_ReadSector(SectorCache_Reader* const reader, cc_u16l* const buffer)
+{
+	const cc_u16l* const sector = SectorCache_GetSector(reader->cache, reader->position);
+	cc_bool success;
+
+	if (sector != NULL)
+	{
+		memcpy(buffer, sector, SECTORCACHE_SECTOR_WORDS * sizeof(cc_u16l));
+		reader->cd_reader_in_position = cc_false;
+		success = cc_true;
+	}
+	else if (reader->cd_reader != NULL && (reader->cd_reader_in_position || CDReader_SeekToSector(reader->cd_reader, reader->position)))
+	{
+		success = CDReader_ReadSector(reader->cd_reader, buffer);
+		reader->cd_reader_in_position = success;
+	}
+	else
+	{
+		memset(buffer, 0, SECTORCACHE_SECTOR_WORDS * sizeof(cc_u16l));
+		success = cc_false;
+	}
+
+	++reader->position;
+
+	return success;
+}
@@ -0,0 +1,54 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_SECTOR_CACHE_H
+#define CLOWNMDEMU_FRONTEND_COMMON_SECTOR_CACHE_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+
+#include "cd-reader.h"
+
+/* A copy of a disc's data track, which can be shared by any number of
+   emulators running the same disc. It is read once when it is created and
+   never modified afterwards, so it can be used from any thread without
+   locking.
+
+   Each emulator reads from it through its own 'SectorCache_Reader', from its
+   'cd_seeked' and 'cd_sector_read' callbacks. Sectors beyond the end of the
+   cache are read from the emulator's own CD reader, if it has one.
+
+   The CD reader which the cache is filled from is returned to its previous
+   position afterwards. If nothing could be read from it, the cache is empty,
+   and every sector is read from the emulators' CD readers instead. */
+
+typedef struct SectorCache
+{
+	cc_u16l *sectors;
+	CDReader_SectorIndex total_sectors;
+} SectorCache;
+
+typedef struct SectorCache_Reader
+{
+	const SectorCache *cache;
+	CDReader_State *cd_reader;
+	CDReader_SectorIndex position;
+	/* Whether the CD reader is already at 'position', so that sequential reads do not need to seek. */
+	cc_bool cd_reader_in_position;
+} SectorCache_Reader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cc_bool SectorCache_Initialise(SectorCache *cache, CDReader_State *cd_reader, CDReader_SectorIndex maximum_sectors);
+void SectorCache_Deinitialise(SectorCache *cache);
+const cc_u16l* SectorCache_GetSector(const SectorCache *cache, CDReader_SectorIndex sector_index);
+
+void SectorCache_Reader_Initialise(SectorCache_Reader *reader, const SectorCache *cache, CDReader_State *cd_reader);
+void SectorCache_Reader_SeekToSector(SectorCache_Reader *reader, CDReader_SectorIndex sector_index);
+cc_bool SectorCache_Reader_ReadSector(SectorCache_Reader *reader, cc_u16l *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_SECTOR_CACHE_H */
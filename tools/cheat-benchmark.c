@@ -0,0 +1,155 @@
+/* Measures the cost of decoding cheat codes and of applying them each frame. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../cheat.h"
+#include "cheat-codes.h"
+
+#define TOTAL_CODES 0x10000
+#define TOTAL_DECODE_PASSES 16
+#define TOTAL_FRAMES 100000
+#define ROM_LENGTH 0x200000 /* 4MiB, in words. */
+
+static char codes[TOTAL_CODES][CHEAT_CODES_BUFFER_SIZE];
+static cc_u16l rom[ROM_LENGTH];
+static ClownMDEmu clownmdemu;
+static CheatManager manager;
+
+static unsigned long random_state = 1;
+
+static unsigned long Random(void)
+{
+	/* Xorshift; more than good enough for making up cheats. */
+	random_state ^= (random_state << 13) & 0xFFFFFFFF;
+	random_state ^= random_state >> 17;
+	random_state ^= (random_state << 5) & 0xFFFFFFFF;
+	return random_state;
+}
+
+static void RandomCheat(CheatManager_DecodedCheat* const cheat, const cc_bool ram)
+{
+	if (ram)
+		cheat->address = 0xFF0000 | (Random() & 0xFFFE);
+	else
+		cheat->address = (Random() % ROM_LENGTH) * 2;
+
+	cheat->value = Random() & 0xFFFF;
+}
+
+static double SecondsSince(const clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void BenchmarkDecode(void)
+{
+	unsigned long i, pass, total_decoded = 0;
+	clock_t start;
+	double seconds;
+
+	/* Build a corpus with an even mix of all supported formats. */
+	for (i = 0; i < TOTAL_CODES; ++i)
+	{
+		CheatManager_DecodedCheat cheat;
+
+		RandomCheat(&cheat, (i & 1) != 0);
+
+		switch (i % 3)
+		{
+			case 0:
+				CheatCodes_EncodeGameGenie(codes[i], &cheat);
+				break;
+
+			case 1:
+				CheatCodes_EncodeActionReplay(codes[i], &cheat);
+				break;
+
+			case 2:
+				CheatCodes_EncodeRealActionReplay(codes[i], &cheat);
+				break;
+		}
+	}
+
+	start = clock();
+
+	for (pass = 0; pass < TOTAL_DECODE_PASSES; ++pass)
+	{
+		for (i = 0; i < TOTAL_CODES; ++i)
+		{
+			CheatManager_DecodedCheat cheat;
+
+			if (CheatManager_DecodeCheat(&cheat, codes[i]))
+				++total_decoded;
+		}
+	}
+
+	seconds = SecondsSince(start);
+
+	if (total_decoded != (unsigned long)TOTAL_CODES * TOTAL_DECODE_PASSES)
+		fprintf(stderr, "Warning: only %lu of %lu codes decoded.\n", total_decoded, (unsigned long)TOTAL_CODES * TOTAL_DECODE_PASSES);
+
+	printf("Decode: %lu codes in %.3fs (%.0f codes/s)\n", total_decoded, seconds, seconds != 0 ? total_decoded / seconds : 0.0);
+}
+
+static void BenchmarkApply(const unsigned int requested_cheats)
+{
+	const unsigned int total_cheats = CC_MIN(requested_cheats, (unsigned int)CC_COUNT_OF(manager.cheats));
+
+	unsigned int i;
+	unsigned long frame;
+	clock_t start;
+	double ram_seconds, rom_seconds;
+
+	CheatManager_ResetCheats(&manager, rom, ROM_LENGTH);
+
+	/* Half of the cheats patch RAM, and the other half patch ROM. */
+	for (i = 0; i < total_cheats; ++i)
+	{
+		CheatManager_DecodedCheat cheat;
+
+		RandomCheat(&cheat, (i & 1) != 0);
+		CheatManager_AddDecodedCheat(&manager, rom, ROM_LENGTH, i, cc_true, &cheat);
+	}
+
+	/* This is done every frame. */
+	start = clock();
+
+	for (frame = 0; frame < TOTAL_FRAMES; ++frame)
+		CheatManager_ApplyRAMPatches(&manager, &clownmdemu);
+
+	ram_seconds = SecondsSince(start);
+
+	/* This is done whenever a save state is loaded, which rewinding does every frame. */
+	start = clock();
+
+	for (frame = 0; frame < TOTAL_FRAMES; ++frame)
+	{
+		CheatManager_UndoROMPatches(&manager, rom, ROM_LENGTH);
+		CheatManager_ApplyROMPatches(&manager, rom, ROM_LENGTH);
+	}
+
+	rom_seconds = SecondsSince(start);
+
+	printf("Apply (%4u cheats", total_cheats);
+
+	if (total_cheats != requested_cheats)
+		printf(", capped from %u", requested_cheats);
+
+	printf("): RAM %.1fns/frame, ROM undo+apply %.1fns/frame\n", ram_seconds * 1e9 / TOTAL_FRAMES, rom_seconds * 1e9 / TOTAL_FRAMES);
+}
+
+int main(void)
+{
+	static const unsigned int cheat_counts[] = {1, 64, 256, 1000};
+
+	unsigned int i;
+
+	BenchmarkDecode();
+
+	for (i = 0; i < CC_COUNT_OF(cheat_counts); ++i)
+		BenchmarkApply(cheat_counts[i]);
+
+	return EXIT_SUCCESS;
+}
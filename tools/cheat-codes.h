@@ -0,0 +1,56 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_TOOLS_CHEAT_CODES_H
+#define CLOWNMDEMU_FRONTEND_COMMON_TOOLS_CHEAT_CODES_H
+
+/* Encoders which are the inverse of the decoders in 'cheat.c', used by the benchmark and fuzzer to produce codes. */
+
+#include <stdio.h>
+
+#include "../cheat.h"
+
+#define CHEAT_CODES_BUFFER_SIZE 16
+
+static void CheatCodes_EncodeGameGenie(char* const buffer, const CheatManager_DecodedCheat* const cheat)
+{
+	static const char alphabet[] = "ABCDEFGHJKLMNPRSTVWXYZ0123456789";
+
+	unsigned int bytes[5];
+	unsigned int i, buffer_index = 0;
+	unsigned int combiner = 0, total_combined_bits = 0;
+
+	/* Scramble the address and value into 8-bit integers. */
+	bytes[0] = cheat->value & 0xFF;
+	bytes[1] = (cheat->address >> 8) & 0xFF;
+	bytes[2] = (cheat->address >> 16) & 0xFF;
+	bytes[3] = ((cheat->value >> 13) & 7) | ((cheat->value >> 5) & 0xF8);
+	bytes[4] = cheat->address & 0xFF;
+
+	/* Split the 8-bit integers into 5-bit characters. */
+	for (i = 0; i < CC_COUNT_OF(bytes); ++i)
+	{
+		combiner = (combiner << 8 | bytes[i]) & 0xFFF;
+		total_combined_bits += 8;
+
+		while (total_combined_bits >= 5)
+		{
+			total_combined_bits -= 5;
+			buffer[buffer_index++] = alphabet[(combiner >> total_combined_bits) & 0x1F];
+
+			if (buffer_index == 4)
+				buffer[buffer_index++] = '-';
+		}
+	}
+
+	buffer[buffer_index] = '\0';
+}
+
+static void CheatCodes_EncodeActionReplay(char* const buffer, const CheatManager_DecodedCheat* const cheat)
+{
+	sprintf(buffer, "%06lX:%04X", cheat->address & 0xFFFFFF, (unsigned int)cheat->value);
+}
+
+static void CheatCodes_EncodeRealActionReplay(char* const buffer, const CheatManager_DecodedCheat* const cheat)
+{
+	sprintf(buffer, "%05lX %05lX", (cheat->address & 0xFFFFFF) >> 4, (cheat->address & 0xF) << 16 | cheat->value);
+}
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_TOOLS_CHEAT_CODES_H */
@@ -0,0 +1,163 @@
+/* Fuzzing harness for the cheat manager, usable with both libFuzzer and AFL.
+
+   The first half of the input is fed to the decoder as a string, which checks
+   that anything which decodes survives being re-encoded in every format.
+
+   The second half is used to build a ROM and a list of cheats, which checks
+   that undoing the cheats' patches, either directly or by loading a
+   snapshot, restores the ROM bit-for-bit. */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../cheat.h"
+#include "cheat-codes.h"
+
+#define MAXIMUM_CODE_LENGTH 0x40
+#define MAXIMUM_ROM_LENGTH 0x100 /* In words. Kept small so that cheats overlap often. */
+
+static cc_bool CheatsEqual(const CheatManager_DecodedCheat* const a, const CheatManager_DecodedCheat* const b)
+{
+	/* Only the lower 24 bits of the address are seen by the 68000. */
+	return (a->address & 0xFFFFFF) == (b->address & 0xFFFFFF) && a->value == b->value;
+}
+
+static void CheckRoundTrip(const CheatManager_DecodedCheat* const cheat, void (* const encode)(char *buffer, const CheatManager_DecodedCheat *cheat))
+{
+	char code[CHEAT_CODES_BUFFER_SIZE];
+	CheatManager_DecodedCheat decoded_cheat;
+
+	encode(code, cheat);
+
+	if (!CheatManager_DecodeCheat(&decoded_cheat, code) || !CheatsEqual(cheat, &decoded_cheat))
+		abort();
+}
+
+static void FuzzDecode(const unsigned char* const data, const size_t size)
+{
+	char code[MAXIMUM_CODE_LENGTH + 1];
+	CheatManager_DecodedCheat cheat;
+	const size_t length = CC_MIN(size, MAXIMUM_CODE_LENGTH);
+
+	memcpy(code, data, length);
+	code[length] = '\0';
+
+	if (!CheatManager_DecodeCheat(&cheat, code))
+		return;
+
+	CheckRoundTrip(&cheat, CheatCodes_EncodeGameGenie);
+	CheckRoundTrip(&cheat, CheatCodes_EncodeActionReplay);
+	CheckRoundTrip(&cheat, CheatCodes_EncodeRealActionReplay);
+}
+
+static void FuzzPatches(const unsigned char* const data, const size_t size)
+{
+	static CheatManager manager;
+	static ClownMDEmu clownmdemu;
+	static CheatManager_Snapshot snapshot, deserialised_snapshot, empty_snapshot;
+	static unsigned char serialised_snapshot[CHEATMANAGER_SNAPSHOT_MAXIMUM_SERIALISED_SIZE];
+
+	cc_u16l rom[MAXIMUM_ROM_LENGTH], original_rom[MAXIMUM_ROM_LENGTH];
+	size_t rom_length, i;
+	const unsigned char *cursor = data;
+	const unsigned char* const end = data + size;
+
+	if (size == 0)
+		return;
+
+	/* The first byte chooses the size of the ROM, and the following bytes fill it. */
+	rom_length = 1 + *cursor++ % MAXIMUM_ROM_LENGTH;
+
+	for (i = 0; i < rom_length; ++i)
+	{
+		rom[i] = 0;
+
+		if (end - cursor >= 2)
+		{
+			rom[i] = (cc_u16l)cursor[0] << 8 | cursor[1];
+			cursor += 2;
+		}
+	}
+
+	memcpy(original_rom, rom, rom_length * sizeof(*rom));
+
+	/* The remaining bytes are a list of cheats: index, flags, address, value. */
+	while (end - cursor >= 6)
+	{
+		CheatManager_DecodedCheat cheat;
+		const unsigned int index = cursor[0];
+		const cc_bool enabled = (cursor[1] & 1) != 0;
+
+		/* Bias the address towards the ROM, but allow RAM addresses and odd addresses too. */
+		cheat.address = ((unsigned long)cursor[2] << 8 | cursor[3]) % (rom_length * 2 + 2);
+
+		if ((cursor[1] & 2) != 0)
+			cheat.address |= 0xFF0000;
+
+		cheat.value = (unsigned short)(cursor[4] << 8 | cursor[5]);
+
+		cursor += 6;
+
+		CheatManager_AddDecodedCheat(&manager, rom, rom_length, index, enabled, &cheat);
+
+		/* Interleave undo/apply cycles, as rewinding does. */
+		if ((cursor[-5] & 4) != 0)
+		{
+			CheatManager_UndoROMPatches(&manager, rom, rom_length);
+
+			if (memcmp(rom, original_rom, rom_length * sizeof(*rom)) != 0)
+				abort();
+
+			CheatManager_ApplyROMPatches(&manager, rom, rom_length);
+		}
+
+		CheatManager_ApplyRAMPatches(&manager, &clownmdemu);
+	}
+
+	/* Snapshots must survive serialisation, and loading an empty one must behave like a reset. */
+	CheatManager_SaveSnapshot(&manager, &snapshot);
+
+	if (!CheatManager_DeserialiseSnapshot(&deserialised_snapshot, serialised_snapshot, CheatManager_SerialiseSnapshot(&snapshot, serialised_snapshot)))
+		abort();
+
+	CheatManager_LoadSnapshot(&manager, rom, rom_length, &empty_snapshot);
+
+	if (memcmp(rom, original_rom, rom_length * sizeof(*rom)) != 0)
+		abort();
+
+	CheatManager_LoadSnapshot(&manager, rom, rom_length, &deserialised_snapshot);
+	CheatManager_ResetCheats(&manager, rom, rom_length);
+
+	if (memcmp(rom, original_rom, rom_length * sizeof(*rom)) != 0)
+		abort();
+}
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const unsigned char* const data, const size_t size)
+{
+	const size_t split = size / 2;
+
+	FuzzDecode(data, split);
+	FuzzPatches(data + split, size - split);
+
+	return 0;
+}
+
+#ifdef CHEAT_FUZZER_STANDALONE
+
+/* For AFL and for reproducing crashes: read a single input from stdin. */
+
+#include <stdio.h>
+
+int main(void)
+{
+	static unsigned char buffer[0x10000];
+
+	const size_t size = fread(buffer, 1, sizeof(buffer), stdin);
+
+	return LLVMFuzzerTestOneInput(buffer, size);
+}
+
+#endif
@@ -0,0 +1,508 @@
+/* Measures how quickly frames can be emulated without a GUI, with audio being
+   mixed, CD data being read, and cheats being applied, as in a real frontend.
+   Video is discarded.
+
+   Usage: emulator-benchmark [-frames N] [-cheat CODE]... [-cd CUE] [ROM]
+
+   Without a ROM or CD, a generated test ROM is used instead, so that this can
+   run without any user-supplied files. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIXER_IMPLEMENTATION
+#include "../mixer.h"
+
+#include "../cd-reader.h"
+#include "../cheat.h"
+#include "../core/source/clownmdemu.h"
+#include "../profiler.h"
+
+#define DEFAULT_TOTAL_FRAMES 6000
+#define MAXIMUM_ROM_SIZE 0x800000 /* 8MiB, in bytes. */
+#define GENERATED_ROM_SIZE 0x20000
+
+enum
+{
+	TIMER_CORE,
+	TIMER_FM,
+	TIMER_PSG,
+	TIMER_PCM,
+	TIMER_CDDA,
+	TIMER_CD_READER,
+	TIMER_MIXER,
+	TIMER_CHEATS,
+	TIMER_TOTAL
+};
+
+static const char* const timer_names[TIMER_TOTAL] = {
+	"Core",
+	"FM",
+	"PSG",
+	"PCM",
+	"CDDA",
+	"CD reader",
+	"Mixer",
+	"Cheats"
+};
+
+/* In microseconds. */
+static double timers[TIMER_TOTAL];
+
+static ClownMDEmu clownmdemu;
+static Mixer_State mixer;
+static CDReader_State cd_reader;
+static CheatManager cheat_manager;
+
+static cc_u16l rom[MAXIMUM_ROM_SIZE / 2];
+static size_t rom_size;
+
+/* Generated ROM */
+
+static size_t generated_position;
+
+static void Emit(const cc_u16f word)
+{
+	rom[generated_position++ / 2] = word;
+}
+
+static void EmitLongword(const cc_u32f longword)
+{
+	Emit((longword >> 16) & 0xFFFF);
+	Emit(longword & 0xFFFF);
+}
+
+static void GenerateROM(void)
+{
+	static const char header[] = "SEGA MEGA DRIVE BENCHMARK       ";
+
+	size_t loop, inner_loop, i;
+
+	/* Vector table: every exception returns immediately, except for V-blank. */
+	generated_position = 0;
+	EmitLongword(0x00FFFE00); /* Initial stack pointer. */
+	EmitLongword(0x00000200); /* Entry point. */
+
+	for (i = 2; i < 0x40; ++i)
+		EmitLongword(i == 0x1E ? 0x00000300 : 0x000003F0);
+
+	/* Header. */
+	for (i = 0; i < sizeof(header) - 1; i += 2)
+		rom[(0x100 + i) / 2] = (cc_u16l)header[i] << 8 | header[i + 1];
+
+	/* Entry point. */
+	generated_position = 0x200;
+	Emit(0x23FC); EmitLongword(0x53454741); EmitLongword(0x00A14000); /* move.l #'SEGA',($A14000).l */
+	Emit(0x41F9); EmitLongword(0x00C00004);                           /* lea ($C00004).l,a0 */
+	Emit(0x30BC); Emit(0x8004);                                       /* move.w #$8004,(a0) */
+	Emit(0x30BC); Emit(0x8174);                                       /* move.w #$8174,(a0) ; Display and V-blank interrupt on. */
+	Emit(0x30BC); Emit(0x8F02);                                       /* move.w #$8F02,(a0) */
+	Emit(0x43F9); EmitLongword(0x00C00011);                           /* lea ($C00011).l,a1 */
+	Emit(0x12BC); Emit(0x008F);                                       /* move.b #$8F,(a1) ; PSG tone. */
+	Emit(0x12BC); Emit(0x0005);                                       /* move.b #$05,(a1) */
+	Emit(0x12BC); Emit(0x0090);                                       /* move.b #$90,(a1) ; PSG volume. */
+	Emit(0x33FC); Emit(0x0100); EmitLongword(0x00A11100);             /* move.w #$100,($A11100).l ; Request the Z80 bus. */
+	Emit(0x13FC); Emit(0x0028); EmitLongword(0x00A04000);             /* move.b #$28,($A04000).l */
+	Emit(0x13FC); Emit(0x00F0); EmitLongword(0x00A04001);             /* move.b #$F0,($A04001).l ; FM key-on. */
+	Emit(0x46FC); Emit(0x2000);                                       /* move.w #$2000,sr */
+
+	/* Main loop: keep the CPU busy with RAM accesses. */
+	loop = generated_position;
+	Emit(0x5281);                                                     /* addq.l #1,d1 */
+	Emit(0x23C1); EmitLongword(0x00FF0000);                           /* move.l d1,($FF0000).l */
+	Emit(0x45F9); EmitLongword(0x00FF0100);                           /* lea ($FF0100).l,a2 */
+	Emit(0x743F);                                                     /* moveq #63,d2 */
+	inner_loop = generated_position;
+	Emit(0x24C1);                                                     /* move.l d1,(a2)+ */
+	Emit(0x51CA); Emit((inner_loop - generated_position) & 0xFFFF);   /* dbf d2,inner_loop */
+	Emit(0x6000); Emit((loop - generated_position) & 0xFFFF);         /* bra.w loop */
+
+	/* V-blank handler: keep the VDP busy with VRAM writes. */
+	generated_position = 0x300;
+	Emit(0x52B9); EmitLongword(0x00FF0004);                           /* addq.l #1,($FF0004).l */
+	Emit(0x23FC); EmitLongword(0x40000000); EmitLongword(0x00C00004); /* move.l #$40000000,($C00004).l */
+	Emit(0x47F9); EmitLongword(0x00C00000);                           /* lea ($C00000).l,a3 */
+	Emit(0x767F);                                                     /* moveq #127,d3 */
+	inner_loop = generated_position;
+	Emit(0x3681);                                                     /* move.w d1,(a3) */
+	Emit(0x51CB); Emit((inner_loop - generated_position) & 0xFFFF);   /* dbf d3,inner_loop */
+	Emit(0x4E73);                                                     /* rte */
+
+	/* Every other exception. */
+	generated_position = 0x3F0;
+	Emit(0x4E73);                                                     /* rte */
+
+	rom_size = GENERATED_ROM_SIZE;
+}
+
+static cc_bool LoadROM(const char* const path)
+{
+	FILE* const file = fopen(path, "rb");
+	size_t i;
+
+	if (file == NULL)
+		return cc_false;
+
+	for (i = 0; i < CC_COUNT_OF(rom); ++i)
+	{
+		const int high_byte = fgetc(file);
+		const int low_byte = fgetc(file);
+
+		if (high_byte == EOF)
+			break;
+
+		rom[i] = (cc_u16l)high_byte << 8 | (low_byte == EOF ? 0 : low_byte);
+	}
+
+	fclose(file);
+
+	rom_size = i * 2;
+	return rom_size != 0;
+}
+
+/* Emulator callbacks */
+
+/* This is used many times per frame, so it uses the profiler's clock, which, unlike 'clock', does not need a system call on most platforms. */
+#define TIME(TIMER, CODE) \
+	do \
+	{ \
+		const cc_u32f start = Profiler_GetTime(); \
+		CODE; \
+		timers[TIMER] += Profiler_GetMicrosecondsSince(start); \
+	} while (0)
+
+static cc_u8f CartridgeReadCallback(void* const user_data, const cc_u32f address)
+{
+	(void)user_data;
+
+	if (address >= rom_size)
+		return 0;
+
+	return (rom[address / 2] >> ((address & 1) != 0 ? 0 : 8)) & 0xFF;
+}
+
+static void CartridgeWrittenCallback(void* const user_data, const cc_u32f address, const cc_u8f value)
+{
+	(void)user_data;
+	(void)address;
+	(void)value;
+}
+
+static void ColourUpdatedCallback(void* const user_data, const cc_u16f index, const cc_u16f colour)
+{
+	(void)user_data;
+	(void)index;
+	(void)colour;
+}
+
+static void ScanlineRenderedCallback(void* const user_data, const cc_u16f scanline, const cc_u8l* const pixels, const cc_u16f left_boundary, const cc_u16f right_boundary, const cc_u16f screen_width, const cc_u16f screen_height)
+{
+	(void)user_data;
+	(void)scanline;
+	(void)pixels;
+	(void)left_boundary;
+	(void)right_boundary;
+	(void)screen_width;
+	(void)screen_height;
+}
+
+static cc_bool InputRequestedCallback(void* const user_data, const cc_u8f player_id, const ClownMDEmu_Button button_id)
+{
+	(void)user_data;
+	(void)player_id;
+	(void)button_id;
+
+	return cc_false;
+}
+
+static void FMAudioCallback(void* const user_data, const ClownMDEmu* const clownmdemu, const size_t total_frames, void (* const generate_fm_audio)(const ClownMDEmu *clownmdemu, cc_s16l *sample_buffer, size_t total_frames))
+{
+	(void)user_data;
+
+	TIME(TIMER_FM, generate_fm_audio(clownmdemu, Mixer_AllocateFMSamples(&mixer, total_frames), total_frames));
+}
+
+static void PSGAudioCallback(void* const user_data, const ClownMDEmu* const clownmdemu, const size_t total_frames, void (* const generate_psg_audio)(const ClownMDEmu *clownmdemu, cc_s16l *sample_buffer, size_t total_frames))
+{
+	(void)user_data;
+
+	TIME(TIMER_PSG, generate_psg_audio(clownmdemu, Mixer_AllocatePSGSamples(&mixer, total_frames), total_frames));
+}
+
+static void PCMAudioCallback(void* const user_data, const ClownMDEmu* const clownmdemu, const size_t total_frames, void (* const generate_pcm_audio)(const ClownMDEmu *clownmdemu, cc_s16l *sample_buffer, size_t total_frames))
+{
+	(void)user_data;
+
+	TIME(TIMER_PCM, generate_pcm_audio(clownmdemu, Mixer_AllocatePCMSamples(&mixer, total_frames), total_frames));
+}
+
+static void CDDAAudioCallback(void* const user_data, const ClownMDEmu* const clownmdemu, const size_t total_frames, void (* const generate_cdda_audio)(const ClownMDEmu *clownmdemu, cc_s16l *sample_buffer, size_t total_frames))
+{
+	const double cd_reader_time = timers[TIMER_CD_READER];
+
+	(void)user_data;
+
+	TIME(TIMER_CDDA, generate_cdda_audio(clownmdemu, Mixer_AllocateCDDASamples(&mixer, total_frames), total_frames));
+
+	/* This reads the CD's audio, which is already counted by the CD reader's timer, so it must not be counted twice. */
+	timers[TIMER_CDDA] -= timers[TIMER_CD_READER] - cd_reader_time;
+}
+
+static void CDSeekedCallback(void* const user_data, const cc_u32f sector_index)
+{
+	(void)user_data;
+
+	TIME(TIMER_CD_READER, CDReader_SeekToSector(&cd_reader, sector_index));
+}
+
+static void CDSectorReadCallback(void* const user_data, cc_u16l* const buffer)
+{
+	(void)user_data;
+
+	TIME(TIMER_CD_READER, CDReader_ReadSector(&cd_reader, buffer));
+}
+
+static cc_bool CDTrackSeekedCallback(void* const user_data, const cc_u16f track_index, const ClownMDEmu_CDDAMode mode)
+{
+	CDReader_PlaybackSetting playback_setting;
+	cc_bool success;
+
+	(void)user_data;
+
+	switch (mode)
+	{
+		default:
+		case CLOWNMDEMU_CDDA_PLAY_ALL:
+			playback_setting = CDREADER_PLAYBACK_ALL;
+			break;
+
+		case CLOWNMDEMU_CDDA_PLAY_ONCE:
+			playback_setting = CDREADER_PLAYBACK_ONCE;
+			break;
+
+		case CLOWNMDEMU_CDDA_PLAY_REPEAT:
+			playback_setting = CDREADER_PLAYBACK_REPEAT;
+			break;
+	}
+
+	TIME(TIMER_CD_READER, success = CDReader_PlayAudio(&cd_reader, track_index, playback_setting));
+
+	return success;
+}
+
+static size_t CDAudioReadCallback(void* const user_data, cc_s16l* const sample_buffer, const size_t total_frames)
+{
+	size_t frames_read;
+
+	(void)user_data;
+
+	TIME(TIMER_CD_READER, frames_read = CDReader_ReadAudio(&cd_reader, sample_buffer, total_frames));
+
+	return frames_read;
+}
+
+static cc_bool SaveFileOpenedForReadingCallback(void* const user_data, const char* const filename)
+{
+	(void)user_data;
+	(void)filename;
+
+	return cc_false;
+}
+
+static cc_s16f SaveFileReadCallback(void* const user_data)
+{
+	(void)user_data;
+
+	return -1;
+}
+
+static cc_bool SaveFileOpenedForWritingCallback(void* const user_data, const char* const filename)
+{
+	(void)user_data;
+	(void)filename;
+
+	return cc_false;
+}
+
+static void SaveFileWrittenCallback(void* const user_data, const cc_u8f byte)
+{
+	(void)user_data;
+	(void)byte;
+}
+
+static void SaveFileClosedCallback(void* const user_data)
+{
+	(void)user_data;
+}
+
+static cc_bool SaveFileRemovedCallback(void* const user_data, const char* const filename)
+{
+	(void)user_data;
+	(void)filename;
+
+	return cc_false;
+}
+
+static cc_bool SaveFileSizeObtainedCallback(void* const user_data, const char* const filename, size_t* const size)
+{
+	(void)user_data;
+	(void)filename;
+	(void)size;
+
+	return cc_false;
+}
+
+static void DiscardAudio(void* const user_data, const cc_s16l* const audio_samples, const size_t total_frames)
+{
+	(void)user_data;
+	(void)audio_samples;
+	(void)total_frames;
+}
+
+/* Main */
+
+int main(const int argc, char** const argv)
+{
+	ClownMDEmu_Callbacks callbacks;
+	ClownMDEmu_InitialConfiguration configuration;
+	const char *cheats[CHEATMANAGER_MAXIMUM_CHEATS];
+	unsigned long total_frames = DEFAULT_TOTAL_FRAMES, frame;
+	const char *rom_path = NULL, *cd_path = NULL;
+	unsigned int total_cheats = 0, cheat;
+	double total_time;
+	int i;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+		{
+			total_frames = strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-cd") == 0 && i + 1 < argc)
+		{
+			cd_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "-cheat") == 0 && i + 1 < argc && total_cheats < CC_COUNT_OF(cheats))
+		{
+			cheats[total_cheats++] = argv[++i];
+		}
+		else if (argv[i][0] != '-' && rom_path == NULL)
+		{
+			rom_path = argv[i];
+		}
+		else
+		{
+			fputs("Usage: emulator-benchmark [-frames N] [-cheat CODE]... [-cd CUE] [ROM]\n", stderr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (rom_path != NULL)
+	{
+		if (!LoadROM(rom_path))
+		{
+			fprintf(stderr, "Could not load ROM '%s'.\n", rom_path);
+			return EXIT_FAILURE;
+		}
+	}
+	else if (cd_path == NULL)
+	{
+		GenerateROM();
+	}
+
+	CDReader_Initialise(&cd_reader);
+
+	if (cd_path != NULL)
+	{
+		FILE* const file = fopen(cd_path, "rb");
+
+		if (file == NULL)
+		{
+			fprintf(stderr, "Could not open CD '%s'.\n", cd_path);
+			return EXIT_FAILURE;
+		}
+
+		CDReader_Open(&cd_reader, file, cd_path, NULL);
+	}
+
+	/* The cheats must be added after the ROM is loaded, so that their ROM patches apply to it. */
+	CheatManager_ResetCheats(&cheat_manager, rom, rom_size / 2);
+
+	for (cheat = 0; cheat < total_cheats; ++cheat)
+		if (!CheatManager_AddCheat(&cheat_manager, rom, rom_size / 2, cheat, cc_true, cheats[cheat]))
+			fprintf(stderr, "Ignoring invalid cheat '%s'.\n", cheats[cheat]);
+
+	if (!Mixer_Initialise(&mixer, cc_false))
+	{
+		fputs("Could not initialise the mixer.\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	/* This is filled in by name, so that it does not depend on the order of the members. */
+	memset(&callbacks, 0, sizeof(callbacks));
+	callbacks.cartridge_read = CartridgeReadCallback;
+	callbacks.cartridge_written = CartridgeWrittenCallback;
+	callbacks.colour_updated = ColourUpdatedCallback;
+	callbacks.scanline_rendered = ScanlineRenderedCallback;
+	callbacks.input_requested = InputRequestedCallback;
+	callbacks.fm_audio_to_be_generated = FMAudioCallback;
+	callbacks.psg_audio_to_be_generated = PSGAudioCallback;
+	callbacks.pcm_audio_to_be_generated = PCMAudioCallback;
+	callbacks.cdda_audio_to_be_generated = CDDAAudioCallback;
+	callbacks.cd_seeked = CDSeekedCallback;
+	callbacks.cd_sector_read = CDSectorReadCallback;
+	callbacks.cd_track_seeked = CDTrackSeekedCallback;
+	callbacks.cd_audio_read = CDAudioReadCallback;
+	callbacks.save_file_opened_for_reading = SaveFileOpenedForReadingCallback;
+	callbacks.save_file_read = SaveFileReadCallback;
+	callbacks.save_file_opened_for_writing = SaveFileOpenedForWritingCallback;
+	callbacks.save_file_written = SaveFileWrittenCallback;
+	callbacks.save_file_closed = SaveFileClosedCallback;
+	callbacks.save_file_removed = SaveFileRemovedCallback;
+	callbacks.save_file_size_obtained = SaveFileSizeObtainedCallback;
+
+	memset(&configuration, 0, sizeof(configuration));
+	ClownMDEmu_Initialise(&clownmdemu, &configuration, &callbacks);
+	ClownMDEmu_Reset(&clownmdemu, rom_path == NULL && cd_path != NULL, rom_size);
+
+	total_time = 0;
+
+	for (frame = 0; frame < total_frames; ++frame)
+	{
+		const cc_u32f frame_start = Profiler_GetTime();
+
+		TIME(TIMER_CHEATS, CheatManager_ApplyRAMPatches(&cheat_manager, &clownmdemu));
+		TIME(TIMER_MIXER, Mixer_Begin(&mixer));
+		TIME(TIMER_CORE, ClownMDEmu_Iterate(&clownmdemu));
+		TIME(TIMER_MIXER, Mixer_End(&mixer, DiscardAudio, NULL));
+
+		/* Summed per frame, since the clock wraps around. */
+		total_time += Profiler_GetMicrosecondsSince(frame_start);
+	}
+
+	/* The callbacks are run by the core, so exclude them from its time. */
+	for (i = 0; i < TIMER_TOTAL; ++i)
+		if (i != TIMER_CORE && i != TIMER_MIXER && i != TIMER_CHEATS)
+			timers[TIMER_CORE] -= timers[i];
+
+	printf("%lu frames in %.3f seconds: %.1f frames per second (%.1fx real-time).\n",
+		total_frames,
+		total_time / 1000000,
+		total_time != 0 ? total_frames / (total_time / 1000000) : 0.0,
+		total_time != 0 ? total_frames / (total_time / 1000000) / 60 : 0.0);
+
+	for (i = 0; i < TIMER_TOTAL; ++i)
+	{
+		printf("  %-10s %8.3f seconds (%5.1f%%), %8.2f microseconds per frame\n",
+			timer_names[i],
+			timers[i] / 1000000,
+			total_time != 0 ? timers[i] * 100 / total_time : 0.0,
+			total_frames != 0 ? timers[i] / total_frames : 0.0);
+	}
+
+	Mixer_Deinitialise(&mixer);
+	CDReader_Deinitialise(&cd_reader);
+
+	return EXIT_SUCCESS;
+}
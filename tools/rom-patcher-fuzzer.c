@@ -0,0 +1,111 @@
+/* Fuzzing harness for the ROM patcher, usable with both libFuzzer and AFL.
+
+   The first two bytes choose the size of the ROM and the next two choose how
+   much it is allowed to grow, while the rest of the input is the patch. The ROM is
+   filled with a fixed pattern, so that its checksum only depends on its size,
+   which makes it easier for the fuzzer to produce UPS and BPS patches which
+   are accepted.
+
+   This checks that a rejected patch leaves the ROM and its size untouched,
+   and that the reported hashes of an accepted patch are correct. */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../rom-patcher.h"
+
+#define MAXIMUM_ROM_SIZE 0x200 /* In bytes. */
+
+typedef struct MemoryStream
+{
+	const unsigned char *data;
+	size_t size, position;
+} MemoryStream;
+
+static size_t MemoryStream_Read(void* const stream, unsigned char* const buffer, const size_t size)
+{
+	MemoryStream* const memory_stream = (MemoryStream*)stream;
+	const size_t total_bytes = CC_MIN(size, memory_stream->size - memory_stream->position);
+
+	memcpy(buffer, &memory_stream->data[memory_stream->position], total_bytes);
+	memory_stream->position += total_bytes;
+
+	return total_bytes;
+}
+
+static cc_bool MemoryStream_Seek(void* const stream, const size_t position)
+{
+	MemoryStream* const memory_stream = (MemoryStream*)stream;
+
+	if (position > memory_stream->size)
+		return cc_false;
+
+	memory_stream->position = position;
+	return cc_true;
+}
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const unsigned char* const data, const size_t size)
+{
+	static const ROMPatcher_Callbacks callbacks = {MemoryStream_Read, MemoryStream_Seek};
+
+	cc_u16l rom[MAXIMUM_ROM_SIZE / 2], original_rom[MAXIMUM_ROM_SIZE / 2];
+	size_t original_rom_size, rom_size, rom_capacity, i;
+	MemoryStream stream;
+	ROMPatcher_Result result;
+
+	if (size < 4)
+		return 0;
+
+	original_rom_size = rom_size = ((size_t)data[0] << 8 | data[1]) % (MAXIMUM_ROM_SIZE + 1);
+	rom_capacity = rom_size + ((size_t)data[2] << 8 | data[3]) % (MAXIMUM_ROM_SIZE - rom_size + 1);
+
+	for (i = 0; i < CC_COUNT_OF(rom); ++i)
+		rom[i] = (cc_u16l)(i * 0x0101 + 0x0102);
+
+	memcpy(original_rom, rom, sizeof(rom));
+
+	stream.data = data + 4;
+	stream.size = size - 4;
+	stream.position = 0;
+
+	if (ROMPatcher_Apply(rom, &rom_size, rom_capacity, &stream, &callbacks, stream.size, &result))
+	{
+		cc_u32f patch_hash;
+
+		if (rom_size > rom_capacity)
+			abort();
+
+		if (!ROMPatcher_HashPatch(&stream, &callbacks, &patch_hash) || patch_hash != result.patch_hash)
+			abort();
+
+		if (result.patched_rom_hash != ROMPatcher_HashROM(rom, rom_size))
+			abort();
+	}
+	else
+	{
+		if (rom_size != original_rom_size || memcmp(rom, original_rom, sizeof(rom)) != 0)
+			abort();
+	}
+
+	return 0;
+}
+
+#ifdef ROM_PATCHER_FUZZER_STANDALONE
+
+/* For AFL and for reproducing crashes: read a single input from stdin. */
+
+#include <stdio.h>
+
+int main(void)
+{
+	static unsigned char buffer[0x10000];
+
+	const size_t size = fread(buffer, 1, sizeof(buffer), stdin);
+
+	return LLVMFuzzerTestOneInput(buffer, size);
+}
+
+#endif
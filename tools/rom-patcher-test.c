@@ -0,0 +1,134 @@
+/* Known-answer tests for the ROM patcher: a small patch in each format, and
+   some bad patches, which must leave the ROM untouched. */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../rom-patcher.h"
+
+#define ROM_CAPACITY 0x10 /* In bytes. */
+
+typedef struct MemoryStream
+{
+	const unsigned char *data;
+	size_t size, position;
+} MemoryStream;
+
+static const unsigned char original_rom[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H'};
+
+/* Writes "xy" at 2, and "zz" at 8 using a run-length encoded record. */
+static const unsigned char ips_patch[] = {
+	0x50, 0x41, 0x54, 0x43, 0x48, 0x00, 0x00, 0x02, 0x00, 0x02, 0x78, 0x79,
+	0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x02, 0x7A, 0x45, 0x4F, 0x46
+};
+
+static const unsigned char ups_patch[] = {
+	0x55, 0x50, 0x53, 0x31, 0x88, 0x8A, 0x81, 0x20, 0x00, 0x82, 0x20, 0x00,
+	0x81, 0x69, 0x6A, 0x00, 0x1C, 0xB6, 0xDC, 0x68, 0xC8, 0xC4, 0xC4, 0xDF,
+	0xC5, 0xD1, 0x9F, 0x74
+};
+
+/* A source read, a target read, a source copy of data which has already been overwritten, and a target copy. */
+static const unsigned char bps_patch[] = {
+	0x42, 0x50, 0x53, 0x31, 0x88, 0x8A, 0x80, 0x84, 0x85, 0x31, 0x32, 0x8E,
+	0x80, 0x87, 0x84, 0x1C, 0xB6, 0xDC, 0x68, 0xEC, 0x9E, 0x82, 0x02, 0xB8,
+	0x21, 0x06, 0x7A
+};
+
+/* The same as 'ups_patch', but with the wrong checksum for the patched ROM (and a patch checksum to match). */
+static const unsigned char ups_patch_bad_checksum[] = {
+	0x55, 0x50, 0x53, 0x31, 0x88, 0x8A, 0x81, 0x20, 0x00, 0x82, 0x20, 0x00,
+	0x81, 0x69, 0x6A, 0x00, 0x1C, 0xB6, 0xDC, 0x68, 0x1A, 0x9D, 0xC5, 0x27,
+	0x87, 0xFE, 0xD2, 0x31
+};
+
+/* Declares about 256MiB of metadata in a 22-byte patch. */
+static const unsigned char bps_patch_bogus_metadata_size[] = {
+	0x42, 0x50, 0x53, 0x31, 0x88, 0x8A, 0x7F, 0x7F, 0x7F, 0xFF, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static size_t MemoryStream_Read(void* const stream, unsigned char* const buffer, const size_t size)
+{
+	MemoryStream* const memory_stream = (MemoryStream*)stream;
+	const size_t total_bytes = CC_MIN(size, memory_stream->size - memory_stream->position);
+
+	memcpy(buffer, &memory_stream->data[memory_stream->position], total_bytes);
+	memory_stream->position += total_bytes;
+
+	return total_bytes;
+}
+
+static cc_bool MemoryStream_Seek(void* const stream, const size_t position)
+{
+	MemoryStream* const memory_stream = (MemoryStream*)stream;
+
+	if (position > memory_stream->size)
+		return cc_false;
+
+	memory_stream->position = position;
+	return cc_true;
+}
+
+static const ROMPatcher_Callbacks callbacks = {MemoryStream_Read, MemoryStream_Seek};
+
+static cc_bool Test(const char* const name, const unsigned char* const patch, const size_t patch_size, const cc_bool should_succeed, const char* const expected_rom, const size_t expected_rom_size)
+{
+	cc_u16l rom[ROM_CAPACITY / 2];
+	size_t rom_size = sizeof(original_rom);
+	MemoryStream stream;
+	ROMPatcher_Result result;
+	cc_bool success;
+	size_t i;
+
+	/* Fill the spare space, to check that expansions are blanked. */
+	for (i = 0; i < CC_COUNT_OF(rom); ++i)
+		rom[i] = 0xFFFF;
+
+	for (i = 0; i < sizeof(original_rom); i += 2)
+		rom[i / 2] = (cc_u16l)original_rom[i] << 8 | original_rom[i + 1];
+
+	stream.data = patch;
+	stream.size = patch_size;
+	stream.position = 0;
+
+	success = ROMPatcher_Apply(rom, &rom_size, ROM_CAPACITY, &stream, &callbacks, patch_size, &result) == should_succeed;
+
+	if (should_succeed)
+	{
+		cc_u32f patch_hash;
+
+		success = success && ROMPatcher_HashPatch(&stream, &callbacks, &patch_hash) && patch_hash == result.patch_hash;
+		success = success && result.patched_rom_hash == ROMPatcher_HashROM(rom, rom_size);
+	}
+
+	success = success && rom_size == expected_rom_size;
+
+	for (i = 0; success && i < expected_rom_size; ++i)
+		success = ((rom[i / 2] >> (i % 2 != 0 ? 0 : 8)) & 0xFF) == (unsigned char)expected_rom[i];
+
+	/* The unused half of the last word should be blank. */
+	if (success && expected_rom_size % 2 != 0)
+		success = (rom[expected_rom_size / 2] & 0xFF) == 0;
+
+	if (!success)
+		fprintf(stderr, "FAIL: %s\n", name);
+
+	return success;
+}
+
+int main(void)
+{
+	cc_bool success = cc_true;
+
+	success &= Test("IPS", ips_patch, sizeof(ips_patch), cc_true, "ABxyEFGHzz", 10);
+	success &= Test("UPS", ups_patch, sizeof(ups_patch), cc_true, "AbCDEfGHij", 10);
+	success &= Test("BPS", bps_patch, sizeof(bps_patch), cc_true, "AB12ABCD12", 10);
+	success &= Test("UPS with a bad checksum", ups_patch_bad_checksum, sizeof(ups_patch_bad_checksum), cc_false, "ABCDEFGH", 8);
+	success &= Test("Truncated BPS", bps_patch, sizeof(bps_patch) - 1, cc_false, "ABCDEFGH", 8);
+	success &= Test("BPS with a bogus metadata size", bps_patch_bogus_metadata_size, sizeof(bps_patch_bogus_metadata_size), cc_false, "ABCDEFGH", 8);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
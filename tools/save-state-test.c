@@ -0,0 +1,164 @@
+/* Round-trip tests for the save-state format: a captured state must load back
+   exactly, and truncated or corrupted files must either be rejected without
+   touching the emulator, or load the original state. */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../save-state.h"
+
+#define ROM_LENGTH 0x100 /* In words. */
+
+static SaveState_State save_state;
+static ClownMDEmu original_emulator, emulator, untouched_emulator;
+static CDReader_State cd_reader;
+static CheatManager original_cheat_manager, cheat_manager, bad_cheat_manager;
+static cc_u16l rom[ROM_LENGTH];
+
+static size_t SerialiseCheats(const CheatManager* const manager, unsigned char* const buffer)
+{
+	CheatManager_Snapshot snapshot;
+
+	CheatManager_SaveSnapshot(manager, &snapshot);
+	return CheatManager_SerialiseSnapshot(&snapshot, buffer);
+}
+
+/* Returns whether the state loaded, and fails the test if it loaded anything but the original state, or if it
+   failed to load but modified the emulator anyway. */
+static cc_bool Load(const unsigned char* const data, const size_t size, CDReader_State* const loading_cd_reader, cc_bool* const success)
+{
+	emulator = untouched_emulator;
+
+	if (!SaveState_Load(&save_state, data, size, &emulator, loading_cd_reader, &cheat_manager, rom, ROM_LENGTH))
+	{
+		if (memcmp(&emulator.state, &untouched_emulator.state, sizeof(emulator.state)) != 0)
+			*success = cc_false;
+
+		return cc_false;
+	}
+
+	if (memcmp(&emulator.state, &original_emulator.state, sizeof(emulator.state)) != 0)
+		*success = cc_false;
+
+	return cc_true;
+}
+
+int main(void)
+{
+	static unsigned char original_cheats[CHEATMANAGER_SNAPSHOT_MAXIMUM_SERIALISED_SIZE], cheats[CHEATMANAGER_SNAPSHOT_MAXIMUM_SERIALISED_SIZE];
+
+	const unsigned char *encoded;
+	unsigned char *file;
+	unsigned char* const emulator_bytes = (unsigned char*)&original_emulator.state;
+	size_t file_size, i;
+	cc_bool success = cc_true;
+
+	if (!SaveState_Initialise(&save_state))
+		return EXIT_FAILURE;
+
+	CDReader_Initialise(&cd_reader);
+
+	/* Mostly zeroes, like a real emulator's state. This is kept sparse so that the file is small, since it is
+	   loaded once for every byte of it below. */
+	for (i = 0; i < sizeof(original_emulator.state); i += 0x1001)
+		emulator_bytes[i] = (unsigned char)(i * 7 + 1);
+
+	memset(&untouched_emulator.state, 0xA5, sizeof(untouched_emulator.state));
+
+	CheatManager_AddCheat(&original_cheat_manager, rom, ROM_LENGTH, 0, cc_true, "FF0100:0063");
+	CheatManager_AddCheat(&original_cheat_manager, rom, ROM_LENGTH, 1, cc_false, "000010:4E71");
+
+	SaveState_Capture(&save_state, &original_emulator, &cd_reader, &original_cheat_manager);
+	SaveState_Encode(&save_state);
+	encoded = SaveState_GetEncoded(&save_state, &file_size);
+
+	/* Loading decodes into the same buffers, so the file needs its own copy. */
+	file = (unsigned char*)malloc(file_size);
+
+	if (file == NULL)
+		return EXIT_FAILURE;
+
+	memcpy(file, encoded, file_size);
+
+	/* A clean round trip. */
+	if (!Load(file, file_size, &cd_reader, &success))
+	{
+		fputs("FAIL: Round trip\n", stderr);
+		success = cc_false;
+	}
+
+	{
+		const size_t cheats_size = SerialiseCheats(&original_cheat_manager, original_cheats);
+
+		if (SerialiseCheats(&cheat_manager, cheats) != cheats_size || memcmp(original_cheats, cheats, cheats_size) != 0)
+		{
+			fputs("FAIL: Cheats round trip\n", stderr);
+			success = cc_false;
+		}
+	}
+
+	/* Every truncation must be rejected. */
+	for (i = 0; i < file_size; ++i)
+	{
+		if (Load(file, i, &cd_reader, &success))
+		{
+			fprintf(stderr, "FAIL: Truncated to %lu bytes\n", (unsigned long)i);
+			success = cc_false;
+		}
+	}
+
+	/* Corrupting any byte must not load a different state. Some corruptions, like renaming the cheats' chunk to
+	   something unknown, are harmless. */
+	for (i = 0; i < file_size; ++i)
+	{
+		file[i] ^= 1 << i % 8;
+		Load(file, file_size, &cd_reader, &success);
+		file[i] ^= 1 << i % 8;
+	}
+
+	if (!success)
+		fputs("FAIL: A bad file modified the emulator, or loaded the wrong state\n", stderr);
+
+	/* A state without the CD reader's chunk cannot be loaded with a CD reader. */
+	SaveState_Capture(&save_state, &original_emulator, NULL, NULL);
+	SaveState_Encode(&save_state);
+	encoded = SaveState_GetEncoded(&save_state, &file_size);
+	memcpy(file, encoded, file_size);
+
+	if (Load(file, file_size, &cd_reader, &success) || !Load(file, file_size, NULL, &success))
+	{
+		fputs("FAIL: Missing CD reader chunk\n", stderr);
+		success = cc_false;
+	}
+
+	/* Cheats which no code could decode to must be rejected, rather than used to index the ROM.
+	   The checksums are valid, so this is what a crafted file would look like. */
+	for (i = 0; i < 2; ++i)
+	{
+		static const unsigned long bad_addresses[2] = {0x01000010, 0x000011};
+
+		cc_u16l original_rom[ROM_LENGTH];
+
+		bad_cheat_manager = original_cheat_manager;
+		bad_cheat_manager.cheats[0].code.address = bad_addresses[i];
+
+		SaveState_Capture(&save_state, &original_emulator, &cd_reader, &bad_cheat_manager);
+		SaveState_Encode(&save_state);
+		encoded = SaveState_GetEncoded(&save_state, &file_size);
+		memcpy(file, encoded, file_size);
+		memcpy(original_rom, rom, sizeof(rom));
+
+		if (Load(file, file_size, &cd_reader, &success) || memcmp(rom, original_rom, sizeof(rom)) != 0)
+		{
+			fprintf(stderr, "FAIL: Cheat with address 0x%lX\n", bad_addresses[i]);
+			success = cc_false;
+		}
+	}
+
+	free(file);
+	SaveState_Deinitialise(&save_state);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,4 +1,21 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+/* For 'clock_gettime' in 'profiler.c', which must be requested before any system header is included. */
+#define _POSIX_C_SOURCE 199309L
+#endif
+
 #include "cd-reader.c"
 #include "cheat.c"
+#include "condition.c"
+#include "crc32.c"
+#include "delta.c"
+#include "instance-runner.c"
+#include "profiler.c"
+#include "rewind.c"
+#include "rom-patcher.c"
+#include "run-ahead.c"
+#include "save-state.c"
+#include "sector-cache.c"
+#include "video-output.c"
+#include "watch.c"
 #include "clowncd/unity.c"
 #include "core/unity.c"
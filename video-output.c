@@ -0,0 +1,313 @@
+#include "video-output.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define VIDEOOUTPUT_PITCH(STATE) (VIDEOOUTPUT_MAXIMUM_WIDTH * (STATE)->bytes_per_pixel)
+
+static void VideoOutput_SetPaletteEntry(VideoOutput_State* const state, const cc_u16f index, const cc_u16f colour)
+{
+	/* The colour is 0BGR, with four bits per channel. */
+	const cc_u8f red = (colour >> 4 * 0) & 0xF;
+	const cc_u8f green = (colour >> 4 * 1) & 0xF;
+	const cc_u8f blue = (colour >> 4 * 2) & 0xF;
+
+	unsigned char* const entry = state->palette[index];
+
+	switch (state->format)
+	{
+		case VIDEOOUTPUT_FORMAT_RGBA8888:
+			entry[0] = red * 0x11;
+			entry[1] = green * 0x11;
+			entry[2] = blue * 0x11;
+			entry[3] = 0xFF;
+			break;
+
+		case VIDEOOUTPUT_FORMAT_BGRA8888:
+			entry[0] = blue * 0x11;
+			entry[1] = green * 0x11;
+			entry[2] = red * 0x11;
+			entry[3] = 0xFF;
+			break;
+
+		case VIDEOOUTPUT_FORMAT_RGB565:
+		{
+			const unsigned short packed = (unsigned short)((red << 1 | red >> 3) << 11 | (green << 2 | green >> 2) << 5 | (blue << 1 | blue >> 3));
+
+			/* Let the compiler deal with the byte order. */
+			memcpy(entry, &packed, 2);
+			break;
+		}
+	}
+}
+
+/* These are unrolled so that compilers can vectorise the lookups, or at least pipeline them. */
+static void VideoOutput_ConvertLine16(const VideoOutput_State* const state, unsigned char *output, const cc_u8l *pixels, size_t total_pixels)
+{
+	while (total_pixels >= 8)
+	{
+		memcpy(&output[2 * 0], state->palette[pixels[0]], 2);
+		memcpy(&output[2 * 1], state->palette[pixels[1]], 2);
+		memcpy(&output[2 * 2], state->palette[pixels[2]], 2);
+		memcpy(&output[2 * 3], state->palette[pixels[3]], 2);
+		memcpy(&output[2 * 4], state->palette[pixels[4]], 2);
+		memcpy(&output[2 * 5], state->palette[pixels[5]], 2);
+		memcpy(&output[2 * 6], state->palette[pixels[6]], 2);
+		memcpy(&output[2 * 7], state->palette[pixels[7]], 2);
+
+		output += 2 * 8;
+		pixels += 8;
+		total_pixels -= 8;
+	}
+
+	while (total_pixels-- != 0)
+	{
+		memcpy(output, state->palette[*pixels++], 2);
+		output += 2;
+	}
+}
+
+static void VideoOutput_ConvertLine32(const VideoOutput_State* const state, unsigned char *output, const cc_u8l *pixels, size_t total_pixels)
+{
+	while (total_pixels >= 8)
+	{
+		memcpy(&output[4 * 0], state->palette[pixels[0]], 4);
+		memcpy(&output[4 * 1], state->palette[pixels[1]], 4);
+		memcpy(&output[4 * 2], state->palette[pixels[2]], 4);
+		memcpy(&output[4 * 3], state->palette[pixels[3]], 4);
+		memcpy(&output[4 * 4], state->palette[pixels[4]], 4);
+		memcpy(&output[4 * 5], state->palette[pixels[5]], 4);
+		memcpy(&output[4 * 6], state->palette[pixels[6]], 4);
+		memcpy(&output[4 * 7], state->palette[pixels[7]], 4);
+
+		output += 4 * 8;
+		pixels += 8;
+		total_pixels -= 8;
+	}
+
+	while (total_pixels-- != 0)
+	{
+		memcpy(output, state->palette[*pixels++], 4);
+		output += 4;
+	}
+}
+
+static cc_u16f VideoOutput_GetPaletteLinesUsed(const cc_u8l* const pixels, const size_t total_pixels)
+{
+	cc_u16f palette_lines_used = 0;
+	size_t i;
+
+	/* Indices beyond the palette set bits which are never checked, since those colours cannot change. */
+	for (i = 0; i < total_pixels; ++i)
+		palette_lines_used |= (cc_u16f)1 << (pixels[i] / VIDEOOUTPUT_PALETTE_LINE_SIZE);
+
+	return palette_lines_used;
+}
+
+static cc_bool VideoOutput_PaletteUnchanged(const VideoOutput_State* const state, const VideoOutput_Line* const line)
+{
+	cc_u8f i;
+
+	for (i = 0; i < CC_COUNT_OF(state->palette_line_generations); ++i)
+		if ((line->palette_lines_used & (cc_u16f)1 << i) != 0 && state->palette_line_generations[i] > line->palette_generation)
+			return cc_false;
+
+	return cc_true;
+}
+
+static cc_bool VideoOutput_LineMatches(const VideoOutput_State* const state, const VideoOutput_Buffer* const buffer, const cc_u16f scanline, const cc_u8l* const pixels, const cc_u16f left_boundary, const cc_u16f right_boundary)
+{
+	const VideoOutput_Line* const line = &buffer->lines[scanline];
+
+	return line->frame != 0
+		&& line->left_boundary == left_boundary
+		&& line->right_boundary == right_boundary
+		&& VideoOutput_PaletteUnchanged(state, line)
+		&& memcmp(&buffer->indices[scanline * VIDEOOUTPUT_MAXIMUM_WIDTH + left_boundary], &pixels[left_boundary], right_boundary - left_boundary) == 0;
+}
+
+static void VideoOutput_ResizeBuffer(VideoOutput_Buffer* const buffer, const cc_u16f width, const cc_u16f height)
+{
+	cc_u16f i;
+
+	buffer->width = width;
+	buffer->height = height;
+
+	for (i = 0; i < CC_COUNT_OF(buffer->lines); ++i)
+		buffer->lines[i].frame = 0;
+}
+
+static void VideoOutput_MarkDirty(VideoOutput_State* const state, const cc_u16f top, const cc_u16f bottom)
+{
+	state->dirty_top = CC_MIN(state->dirty_top, top);
+	state->dirty_bottom = CC_MAX(state->dirty_bottom, bottom);
+}
+
+cc_bool VideoOutput_Initialise(VideoOutput_State* const state, const VideoOutput_Format format)
+{
+	cc_u16f i;
+
+	state->format = format;
+	state->bytes_per_pixel = format == VIDEOOUTPUT_FORMAT_RGB565 ? 2 : 4;
+
+	for (i = 0; i < CC_COUNT_OF(state->buffers); ++i)
+	{
+		VideoOutput_Buffer* const buffer = &state->buffers[i];
+
+		buffer->pixels = (unsigned char*)calloc(VIDEOOUTPUT_MAXIMUM_HEIGHT, VIDEOOUTPUT_PITCH(state));
+		buffer->indices = (cc_u8l*)calloc(VIDEOOUTPUT_MAXIMUM_HEIGHT, VIDEOOUTPUT_MAXIMUM_WIDTH * sizeof(cc_u8l));
+
+		VideoOutput_ResizeBuffer(buffer, 0, 0);
+	}
+
+	if (state->buffers[0].pixels == NULL || state->buffers[0].indices == NULL || state->buffers[1].pixels == NULL || state->buffers[1].indices == NULL)
+	{
+		VideoOutput_Deinitialise(state);
+		return cc_false;
+	}
+
+	for (i = 0; i < CC_COUNT_OF(state->palette); ++i)
+		VideoOutput_SetPaletteEntry(state, i, 0);
+
+	for (i = 0; i < CC_COUNT_OF(state->raw_palette); ++i)
+		state->raw_palette[i] = 0;
+
+	for (i = 0; i < CC_COUNT_OF(state->palette_line_generations); ++i)
+		state->palette_line_generations[i] = 0;
+
+	state->palette_generation = 0;
+	state->back_buffer = 0;
+	state->frame_counter = 1;
+	state->dirty_top = VIDEOOUTPUT_MAXIMUM_HEIGHT;
+	state->dirty_bottom = 0;
+
+	state->frame.pixels = state->buffers[1].pixels;
+	state->frame.pitch = VIDEOOUTPUT_PITCH(state);
+	state->frame.width = 0;
+	state->frame.height = 0;
+	state->frame.dirty_top = 0;
+	state->frame.dirty_bottom = 0;
+
+	return cc_true;
+}
+
+void VideoOutput_Deinitialise(VideoOutput_State* const state)
+{
+	cc_u8f i;
+
+	for (i = 0; i < CC_COUNT_OF(state->buffers); ++i)
+	{
+		free(state->buffers[i].pixels);
+		free(state->buffers[i].indices);
+	}
+}
+
+void VideoOutput_ColourUpdated(VideoOutput_State* const state, const cc_u16f index, const cc_u16f colour)
+{
+	if (index >= CC_COUNT_OF(state->raw_palette) || state->raw_palette[index] == colour)
+		return;
+
+	state->raw_palette[index] = colour;
+	VideoOutput_SetPaletteEntry(state, index, colour);
+
+	/* Every line converted with the old palette line is now out of date. */
+	state->palette_line_generations[index / VIDEOOUTPUT_PALETTE_LINE_SIZE] = ++state->palette_generation;
+}
+
+void VideoOutput_ScanlineRendered(VideoOutput_State* const state, const cc_u16f scanline, const cc_u8l* const pixels, const cc_u16f left_boundary, cc_u16f right_boundary, const cc_u16f screen_width, const cc_u16f screen_height)
+{
+	VideoOutput_Buffer* const back_buffer = &state->buffers[state->back_buffer];
+	const VideoOutput_Buffer* const front_buffer = &state->buffers[state->back_buffer ^ 1];
+	VideoOutput_Line *line;
+
+	if (scanline >= screen_height || screen_height > VIDEOOUTPUT_MAXIMUM_HEIGHT || screen_width > VIDEOOUTPUT_MAXIMUM_WIDTH)
+		return;
+
+	right_boundary = CC_MIN(right_boundary, screen_width);
+
+	if (left_boundary >= right_boundary)
+		return;
+
+	/* Switching between H32 and H40, or in and out of interlace mode 2, invalidates the whole buffer. */
+	if (back_buffer->width != screen_width || back_buffer->height != screen_height)
+		VideoOutput_ResizeBuffer(back_buffer, screen_width, screen_height);
+
+	line = &back_buffer->lines[scanline];
+
+	if (!VideoOutput_LineMatches(state, back_buffer, scanline, pixels, left_boundary, right_boundary))
+	{
+		unsigned char* const output = &back_buffer->pixels[scanline * VIDEOOUTPUT_PITCH(state) + left_boundary * state->bytes_per_pixel];
+		const size_t total_pixels = right_boundary - left_boundary;
+
+		memcpy(&back_buffer->indices[scanline * VIDEOOUTPUT_MAXIMUM_WIDTH + left_boundary], &pixels[left_boundary], total_pixels);
+
+		if (state->bytes_per_pixel == 2)
+			VideoOutput_ConvertLine16(state, output, &pixels[left_boundary], total_pixels);
+		else
+			VideoOutput_ConvertLine32(state, output, &pixels[left_boundary], total_pixels);
+
+		line->left_boundary = left_boundary;
+		line->right_boundary = right_boundary;
+		line->palette_generation = state->palette_generation;
+		line->palette_lines_used = VideoOutput_GetPaletteLinesUsed(&pixels[left_boundary], total_pixels);
+	}
+
+	line->frame = state->frame_counter;
+
+	if (front_buffer->width != screen_width || front_buffer->height != screen_height || !VideoOutput_LineMatches(state, front_buffer, scanline, pixels, left_boundary, right_boundary))
+		VideoOutput_MarkDirty(state, scanline, scanline + 1);
+}
+
+void VideoOutput_EndFrame(VideoOutput_State* const state)
+{
+	VideoOutput_Buffer* const back_buffer = &state->buffers[state->back_buffer];
+	const VideoOutput_Buffer* const front_buffer = &state->buffers[state->back_buffer ^ 1];
+
+	if (front_buffer->width != back_buffer->width || front_buffer->height != back_buffer->height)
+	{
+		VideoOutput_MarkDirty(state, 0, back_buffer->height);
+	}
+	else
+	{
+		/* Lines that were not rendered this frame (such as the other field when interlacing)
+		   should show their most recent contents, which may be in the front buffer. */
+		cc_u16f i;
+
+		for (i = 0; i < back_buffer->height; ++i)
+		{
+			VideoOutput_Line* const line = &back_buffer->lines[i];
+			const VideoOutput_Line* const front_line = &front_buffer->lines[i];
+
+			if (line->frame != state->frame_counter && front_line->frame > line->frame)
+			{
+				memcpy(&back_buffer->pixels[i * VIDEOOUTPUT_PITCH(state)], &front_buffer->pixels[i * VIDEOOUTPUT_PITCH(state)], VIDEOOUTPUT_PITCH(state));
+				memcpy(&back_buffer->indices[i * VIDEOOUTPUT_MAXIMUM_WIDTH], &front_buffer->indices[i * VIDEOOUTPUT_MAXIMUM_WIDTH], VIDEOOUTPUT_MAXIMUM_WIDTH);
+				*line = *front_line;
+			}
+		}
+	}
+
+	state->frame.pixels = back_buffer->pixels;
+	state->frame.width = back_buffer->width;
+	state->frame.height = back_buffer->height;
+
+	if (state->dirty_top < state->dirty_bottom)
+	{
+		state->frame.dirty_top = state->dirty_top;
+		state->frame.dirty_bottom = state->dirty_bottom;
+	}
+	else
+	{
+		state->frame.dirty_top = state->frame.dirty_bottom = 0;
+	}
+
+	state->back_buffer ^= 1;
+	++state->frame_counter;
+	state->dirty_top = VIDEOOUTPUT_MAXIMUM_HEIGHT;
+	state->dirty_bottom = 0;
+}
+
+const VideoOutput_Frame* VideoOutput_GetFrame(const VideoOutput_State* const state)
+{
+	return &state->frame;
+}
@@ -0,0 +1,170 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_VIDEO_OUTPUT_H
+#define CLOWNMDEMU_FRONTEND_COMMON_VIDEO_OUTPUT_H
+
+#include <stddef.h>
+
+#include "core/libraries/clowncommon/clowncommon.h"
+
+/* Converts the emulator's palette-indexed scanlines into a texture-ready
+   framebuffer. Feed it from the emulator's 'colour_updated' and
+   'scanline_rendered' callbacks, call 'VideoOutput_EndFrame' after each
+   frame, and then display the frame returned by 'VideoOutput_GetFrame'.
+
+   The framebuffer is double-buffered, and lines which have not changed since
+   they were last converted into the back buffer are skipped. Changing a colour
+   only affects the lines which use its palette line, so games which cycle a
+   few colours every frame do not force every line to be converted. Each frame
+   also reports which lines differ from the frame before it, so that only those
+   need uploading. Lines which are not rendered in a frame, like the other
+   field in interlace mode, carry over from the previous frame. */
+
+#define VIDEOOUTPUT_MAXIMUM_WIDTH 320
+#define VIDEOOUTPUT_MAXIMUM_HEIGHT 480
+/* Four palette lines of sixteen colours, in normal, shadow, and highlight brightnesses. */
+#define VIDEOOUTPUT_PALETTE_SIZE (3 * 4 * 16)
+#define VIDEOOUTPUT_PALETTE_LINE_SIZE 16
+
+typedef enum VideoOutput_Format
+{
+	/* These are in byte order. */
+	VIDEOOUTPUT_FORMAT_RGBA8888,
+	VIDEOOUTPUT_FORMAT_BGRA8888,
+	/* This is packed into a native-endian 16-bit integer. */
+	VIDEOOUTPUT_FORMAT_RGB565
+} VideoOutput_Format;
+
+typedef struct VideoOutput_Line
+{
+	cc_u16l left_boundary, right_boundary;
+	/* The palette's generation when the line was converted, and a bitfield of the palette lines that it uses. */
+	unsigned long palette_generation;
+	cc_u16l palette_lines_used;
+	/* 0 if the line has never been written. */
+	unsigned long frame;
+} VideoOutput_Line;
+
+typedef struct VideoOutput_Buffer
+{
+	unsigned char *pixels;
+	cc_u8l *indices;
+	VideoOutput_Line lines[VIDEOOUTPUT_MAXIMUM_HEIGHT];
+	cc_u16f width, height;
+} VideoOutput_Buffer;
+
+typedef struct VideoOutput_Frame
+{
+	const unsigned char *pixels;
+	size_t pitch;
+	cc_u16f width, height;
+	/* The lines from 'dirty_top' up to (but not including) 'dirty_bottom' differ from the previous frame. */
+	cc_u16f dirty_top, dirty_bottom;
+} VideoOutput_Frame;
+
+typedef struct VideoOutput_State
+{
+	cc_u8f bytes_per_pixel;
+	VideoOutput_Format format;
+
+	/* This is larger than needed so that no index can read out of bounds. */
+	unsigned char palette[0x100][4];
+	cc_u16l raw_palette[VIDEOOUTPUT_PALETTE_SIZE];
+	/* Incremented whenever a colour changes. Each palette line records the generation that it was last changed in. */
+	unsigned long palette_generation;
+	unsigned long palette_line_generations[VIDEOOUTPUT_PALETTE_SIZE / VIDEOOUTPUT_PALETTE_LINE_SIZE];
+
+	VideoOutput_Buffer buffers[2];
+	cc_u8f back_buffer;
+	unsigned long frame_counter;
+	cc_u16f dirty_top, dirty_bottom;
+
+	VideoOutput_Frame frame;
+} VideoOutput_State;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cc_bool VideoOutput_Initialise(VideoOutput_State *state, VideoOutput_Format format);
+void VideoOutput_Deinitialise(VideoOutput_State *state);
+void VideoOutput_ColourUpdated(VideoOutput_State *state, cc_u16f index, cc_u16f colour);
+void VideoOutput_ScanlineRendered(VideoOutput_State *state, cc_u16f scanline, const cc_u8l *pixels, cc_u16f left_boundary, cc_u16f right_boundary, cc_u16f screen_width, cc_u16f screen_height);
+void VideoOutput_EndFrame(VideoOutput_State *state);
+const VideoOutput_Frame* VideoOutput_GetFrame(const VideoOutput_State *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <cassert>
+#include <utility>
+
+class VideoOutput
+{
+protected:
+	VideoOutput_State state;
+	bool initialised;
+
+public:
+	typedef VideoOutput_Format Format;
+	typedef VideoOutput_Frame Frame;
+
+	VideoOutput(const Format format)
+	{
+		initialised = VideoOutput_Initialise(&state, format);
+	}
+	VideoOutput(const VideoOutput &other) = delete;
+	VideoOutput(VideoOutput &&other)
+		: state(other.state)
+		, initialised(other.initialised)
+	{
+		other.initialised = false;
+	}
+	VideoOutput& operator=(const VideoOutput &other) = delete;
+	VideoOutput& operator=(VideoOutput &&other)
+	{
+		std::swap(state, other.state);
+		std::swap(initialised, other.initialised);
+		return *this;
+	}
+
+	~VideoOutput()
+	{
+		if (initialised)
+			VideoOutput_Deinitialise(&state);
+	}
+
+	bool Initialised() const
+	{
+		return initialised;
+	}
+
+	void ColourUpdated(const cc_u16f index, const cc_u16f colour)
+	{
+		assert(Initialised());
+		VideoOutput_ColourUpdated(&state, index, colour);
+	}
+
+	void ScanlineRendered(const cc_u16f scanline, const cc_u8l* const pixels, const cc_u16f left_boundary, const cc_u16f right_boundary, const cc_u16f screen_width, const cc_u16f screen_height)
+	{
+		assert(Initialised());
+		VideoOutput_ScanlineRendered(&state, scanline, pixels, left_boundary, right_boundary, screen_width, screen_height);
+	}
+
+	void EndFrame()
+	{
+		assert(Initialised());
+		VideoOutput_EndFrame(&state);
+	}
+
+	const Frame& GetFrame() const
+	{
+		assert(Initialised());
+		return *VideoOutput_GetFrame(&state);
+	}
+};
+
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_VIDEO_OUTPUT_H */
@@ -0,0 +1,225 @@
+#include "watch.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/* How many watches are compared at once. Most blocks are expected to be unchanged. */
+#define WATCHMANAGER_BLOCK_SIZE 16
+
+#define WATCHMANAGER_RAM_LENGTH CC_COUNT_OF(((const ClownMDEmu*)NULL)->state.m68k.ram)
+
+#define WatchManager_IsRAMAddress(ADDRESS) (((ADDRESS) & 0xFFFFFF) >= 0xE00000 && (ADDRESS) % 2 == 0)
+#define WatchManager_ToRAMIndex(ADDRESS) (((ADDRESS) / 2) % WATCHMANAGER_RAM_LENGTH)
+#define WatchManager_ToAddress(RAM_INDEX) (0xFF0000 | (unsigned long)(RAM_INDEX) * 2)
+
+static unsigned int WatchManager_LowerBound(const WatchManager* const manager, const cc_u16f ram_index)
+{
+	unsigned int low = 0, high = manager->total_watches;
+
+	while (low != high)
+	{
+		const unsigned int middle = low + (high - low) / 2;
+
+		if (manager->ram_indices[middle] < ram_index)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+static cc_bool WatchManager_FindWatch(const WatchManager* const manager, const unsigned long address, unsigned int* const position)
+{
+	const cc_u16f ram_index = WatchManager_ToRAMIndex(address);
+
+	if (!WatchManager_IsRAMAddress(address))
+		return cc_false;
+
+	*position = WatchManager_LowerBound(manager, ram_index);
+
+	return *position != manager->total_watches && manager->ram_indices[*position] == ram_index;
+}
+
+static cc_bool WatchManager_FindFrozen(const WatchManager* const manager, const unsigned long address, unsigned int* const position)
+{
+	unsigned int i;
+
+	for (i = 0; i < manager->total_frozen; ++i)
+	{
+		if (manager->frozen[i].address == address)
+		{
+			*position = i;
+			return cc_true;
+		}
+	}
+
+	return cc_false;
+}
+
+void WatchManager_Initialise(WatchManager* const manager)
+{
+	WatchManager_ResetWatches(manager);
+}
+
+cc_bool WatchManager_AddWatch(WatchManager* const manager, const ClownMDEmu* const clownmdemu, const unsigned long address)
+{
+	const cc_u16f ram_index = WatchManager_ToRAMIndex(address);
+
+	unsigned int position;
+	size_t total_to_move;
+
+	if (!WatchManager_IsRAMAddress(address))
+		return cc_false;
+
+	position = WatchManager_LowerBound(manager, ram_index);
+
+	/* Watches are deduplicated. */
+	if (position != manager->total_watches && manager->ram_indices[position] == ram_index)
+		return cc_true;
+
+	if (manager->total_watches == CC_COUNT_OF(manager->ram_indices))
+		return cc_false;
+
+	/* Make room, keeping the list sorted. */
+	total_to_move = manager->total_watches - position;
+	memmove(&manager->ram_indices[position + 1], &manager->ram_indices[position], total_to_move * sizeof(*manager->ram_indices));
+	memmove(&manager->previous_values[position + 1], &manager->previous_values[position], total_to_move * sizeof(*manager->previous_values));
+	memmove(&manager->current_values[position + 1], &manager->current_values[position], total_to_move * sizeof(*manager->current_values));
+
+	manager->ram_indices[position] = ram_index;
+	manager->previous_values[position] = manager->current_values[position] = clownmdemu->state.m68k.ram[ram_index];
+
+	++manager->total_watches;
+
+	return cc_true;
+}
+
+cc_bool WatchManager_RemoveWatch(WatchManager* const manager, const unsigned long address)
+{
+	unsigned int position;
+	size_t total_to_move;
+
+	if (!WatchManager_FindWatch(manager, address, &position))
+		return cc_false;
+
+	WatchManager_UnfreezeWatch(manager, address);
+
+	--manager->total_watches;
+
+	total_to_move = manager->total_watches - position;
+	memmove(&manager->ram_indices[position], &manager->ram_indices[position + 1], total_to_move * sizeof(*manager->ram_indices));
+	memmove(&manager->previous_values[position], &manager->previous_values[position + 1], total_to_move * sizeof(*manager->previous_values));
+	memmove(&manager->current_values[position], &manager->current_values[position + 1], total_to_move * sizeof(*manager->current_values));
+
+	return cc_true;
+}
+
+void WatchManager_ResetWatches(WatchManager* const manager)
+{
+	manager->total_watches = 0;
+	manager->total_frozen = 0;
+	manager->total_changes = 0;
+}
+
+cc_bool WatchManager_GetValue(const WatchManager* const manager, const unsigned long address, cc_u16f* const value)
+{
+	unsigned int position;
+
+	if (!WatchManager_FindWatch(manager, address, &position))
+		return cc_false;
+
+	*value = manager->previous_values[position];
+	return cc_true;
+}
+
+cc_bool WatchManager_FreezeWatch(WatchManager* const manager, const unsigned long address, const cc_u16f value)
+{
+	const unsigned long canonical_address = WatchManager_ToAddress(WatchManager_ToRAMIndex(address));
+
+	unsigned int position;
+
+	if (!WatchManager_FindWatch(manager, address, &position))
+		return cc_false;
+
+	if (!WatchManager_FindFrozen(manager, canonical_address, &position))
+		position = manager->total_frozen++;
+
+	manager->frozen[position].address = canonical_address;
+	manager->frozen[position].value = value;
+
+	return cc_true;
+}
+
+cc_bool WatchManager_UnfreezeWatch(WatchManager* const manager, const unsigned long address)
+{
+	unsigned int position;
+
+	if (!WatchManager_IsRAMAddress(address))
+		return cc_false;
+
+	if (!WatchManager_FindFrozen(manager, WatchManager_ToAddress(WatchManager_ToRAMIndex(address)), &position))
+		return cc_false;
+
+	/* Order does not matter, so just move the last entry into the gap. */
+	manager->frozen[position] = manager->frozen[--manager->total_frozen];
+
+	return cc_true;
+}
+
+void WatchManager_ApplyFreezes(const WatchManager* const manager, ClownMDEmu* const clownmdemu)
+{
+	unsigned int i;
+
+	for (i = 0; i < manager->total_frozen; ++i)
+		CheatManager_ApplyRAMPatch(clownmdemu, &manager->frozen[i]);
+}
+
+void WatchManager_Update(WatchManager* const manager, const ClownMDEmu* const clownmdemu)
+{
+	const cc_u16l* const ram = clownmdemu->state.m68k.ram;
+	const unsigned int total_watches = manager->total_watches;
+
+	unsigned int i, block;
+
+	manager->total_changes = 0;
+
+	/* Gather the watched words into a contiguous array. */
+	for (i = 0; i < total_watches; ++i)
+		manager->current_values[i] = ram[manager->ram_indices[i]];
+
+	/* Compare against the previous values a block at a time: the inner loop is
+	   easily vectorised by the compiler, and unchanged blocks are skipped entirely. */
+	for (block = 0; block < total_watches; block += WATCHMANAGER_BLOCK_SIZE)
+	{
+		const unsigned int block_end = CC_MIN(block + WATCHMANAGER_BLOCK_SIZE, total_watches);
+
+		cc_u16f difference = 0;
+
+		for (i = block; i < block_end; ++i)
+			difference |= manager->current_values[i] ^ manager->previous_values[i];
+
+		if (difference == 0)
+			continue;
+
+		for (i = block; i < block_end; ++i)
+		{
+			if (manager->current_values[i] != manager->previous_values[i])
+			{
+				WatchManager_Change* const change = &manager->changes[manager->total_changes++];
+
+				change->address = WatchManager_ToAddress(manager->ram_indices[i]);
+				change->old_value = manager->previous_values[i];
+				change->new_value = manager->current_values[i];
+
+				manager->previous_values[i] = manager->current_values[i];
+			}
+		}
+	}
+}
+
+const WatchManager_Change* WatchManager_GetChanges(const WatchManager* const manager, unsigned int* const total_changes)
+{
+	*total_changes = manager->total_changes;
+	return manager->changes;
+}
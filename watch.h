@@ -0,0 +1,115 @@
+#ifndef CLOWNMDEMU_FRONTEND_COMMON_WATCH_H
+#define CLOWNMDEMU_FRONTEND_COMMON_WATCH_H
+
+#include "core/libraries/clowncommon/clowncommon.h"
+#include "core/source/clownmdemu.h"
+
+#include "cheat.h"
+
+/* Watches are word-sized, matching the granularity of cheats. */
+
+#define WATCHMANAGER_MAXIMUM_WATCHES 0x400
+
+typedef struct WatchManager_Change
+{
+	unsigned long address;
+	cc_u16l old_value, new_value;
+} WatchManager_Change;
+
+typedef struct WatchManager
+{
+	/* These are kept sorted by RAM index, so that gathering walks RAM in order.
+	   The values are kept in their own arrays so that they can be compared in bulk. */
+	cc_u16l ram_indices[WATCHMANAGER_MAXIMUM_WATCHES];
+	cc_u16l previous_values[WATCHMANAGER_MAXIMUM_WATCHES];
+	cc_u16l current_values[WATCHMANAGER_MAXIMUM_WATCHES];
+	unsigned int total_watches;
+
+	/* Frozen watches are applied in the same way as RAM cheats. */
+	CheatManager_DecodedCheat frozen[WATCHMANAGER_MAXIMUM_WATCHES];
+	unsigned int total_frozen;
+
+	WatchManager_Change changes[WATCHMANAGER_MAXIMUM_WATCHES];
+	unsigned int total_changes;
+} WatchManager;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void WatchManager_Initialise(WatchManager *manager);
+cc_bool WatchManager_AddWatch(WatchManager *manager, const ClownMDEmu *clownmdemu, unsigned long address);
+cc_bool WatchManager_RemoveWatch(WatchManager *manager, unsigned long address);
+void WatchManager_ResetWatches(WatchManager *manager);
+cc_bool WatchManager_GetValue(const WatchManager *manager, unsigned long address, cc_u16f *value);
+
+cc_bool WatchManager_FreezeWatch(WatchManager *manager, unsigned long address, cc_u16f value);
+cc_bool WatchManager_UnfreezeWatch(WatchManager *manager, unsigned long address);
+void WatchManager_ApplyFreezes(const WatchManager *manager, ClownMDEmu *clownmdemu);
+
+void WatchManager_Update(WatchManager *manager, const ClownMDEmu *clownmdemu);
+const WatchManager_Change* WatchManager_GetChanges(const WatchManager *manager, unsigned int *total_changes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+class WatchManagerCXX : private WatchManager
+{
+public:
+	WatchManagerCXX()
+	{
+		WatchManager_Initialise(this);
+	}
+
+	bool AddWatch(const ClownMDEmu* const clownmdemu, const unsigned long address)
+	{
+		return WatchManager_AddWatch(this, clownmdemu, address);
+	}
+
+	bool RemoveWatch(const unsigned long address)
+	{
+		return WatchManager_RemoveWatch(this, address);
+	}
+
+	void ResetWatches()
+	{
+		WatchManager_ResetWatches(this);
+	}
+
+	bool GetValue(const unsigned long address, cc_u16f* const value) const
+	{
+		return WatchManager_GetValue(this, address, value);
+	}
+
+	bool FreezeWatch(const unsigned long address, const cc_u16f value)
+	{
+		return WatchManager_FreezeWatch(this, address, value);
+	}
+
+	bool UnfreezeWatch(const unsigned long address)
+	{
+		return WatchManager_UnfreezeWatch(this, address);
+	}
+
+	void ApplyFreezes(ClownMDEmu* const clownmdemu) const
+	{
+		WatchManager_ApplyFreezes(this, clownmdemu);
+	}
+
+	void Update(const ClownMDEmu* const clownmdemu)
+	{
+		WatchManager_Update(this, clownmdemu);
+	}
+
+	const WatchManager_Change* GetChanges(unsigned int* const total_changes) const
+	{
+		return WatchManager_GetChanges(this, total_changes);
+	}
+};
+
+#endif
+
+#endif /* CLOWNMDEMU_FRONTEND_COMMON_WATCH_H */